@@ -0,0 +1,37 @@
+// Замена глобальных operator new/delete действует на всю программу, поэтому она собирается только
+// с флагом SEARCH_SERVER_COUNT_ALLOCATIONS, которым собирают тесты. Она лежит в отдельной единице
+// трансляции, чтобы компилятор не встраивал её в вызывающий код
+#ifdef SEARCH_SERVER_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+#include "test_example_functions.h"
+
+namespace {
+
+thread_local size_t allocation_count = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+size_t GetThreadAllocationCount() {
+    return allocation_count;
+}
+
+#endif
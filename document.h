@@ -1,6 +1,8 @@
 #pragma once
 
 #include <ostream>
+#include <string_view>
+#include <vector>
 
 
 struct Document {
@@ -21,3 +23,11 @@ enum class DocumentStatus {
     BANNED,
     REMOVED,
 };
+
+// Документ для пакетной загрузки SearchServer::AddDocuments
+struct NewDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
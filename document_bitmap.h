@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Множество внутренних номеров документов, по биту на номер. Пустое множество не занимает памяти,
+// а номера за пределами ordinal_count в нём считаются отсутствующими
+class DocumentBitmap {
+public:
+    DocumentBitmap() = default;
+
+    explicit DocumentBitmap(size_t ordinal_count) : words_((ordinal_count + WORD_BIT_COUNT - 1) / WORD_BIT_COUNT) {
+    }
+
+    void Insert(int ordinal) {
+        words_[ordinal / WORD_BIT_COUNT] |= uint64_t(1) << (ordinal % WORD_BIT_COUNT);
+        is_empty_ = false;
+    }
+
+    bool Contains(int ordinal) const {
+        const size_t word_index = ordinal / WORD_BIT_COUNT;
+        return word_index < words_.size() && (words_[word_index] >> (ordinal % WORD_BIT_COUNT) & 1) != 0;
+    }
+
+    bool IsEmpty() const {
+        return is_empty_;
+    }
+
+private:
+    static constexpr size_t WORD_BIT_COUNT = 64;
+
+    std::vector<uint64_t> words_;
+    bool is_empty_ = true;
+};
@@ -0,0 +1,60 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::Add(uint64_t nanoseconds) {
+    ++bucket_counts_[GetBucket(nanoseconds)];
+    ++count_;
+}
+
+void LatencyHistogram::Remove(uint64_t nanoseconds) {
+    --bucket_counts_[GetBucket(nanoseconds)];
+    --count_;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        bucket_counts_[bucket] += other.bucket_counts_[bucket];
+    }
+    count_ += other.count_;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double quantile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(quantile * count_)), 1, count_);
+    uint64_t seen_count = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen_count += bucket_counts_[bucket];
+        if (seen_count >= rank) {
+            return GetBucketUpperBound(bucket);
+        }
+    }
+    return GetBucketUpperBound(BUCKET_COUNT - 1);
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t nanoseconds) {
+    if (nanoseconds < SUB_BUCKET_COUNT) {
+        return nanoseconds;
+    }
+    // Корзина задаётся старшим битом и следующими за ним SUB_BUCKET_BITS битами
+    const int exponent = 63 - __builtin_clzll(nanoseconds);
+    const uint64_t mantissa = (nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + mantissa;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+    const int exponent = static_cast<int>(bucket / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    const uint64_t mantissa = bucket % SUB_BUCKET_COUNT;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    return ((SUB_BUCKET_COUNT + mantissa) << shift) + ((uint64_t(1) << shift) - 1);
+}
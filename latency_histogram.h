@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Гистограмма задержек в наносекундах. Значения меньше SUB_BUCKET_COUNT хранятся точно, остальные
+// попадают в корзины по SUB_BUCKET_COUNT на каждую степень двойки, поэтому перцентиль завышается
+// не больше чем на 1 / SUB_BUCKET_COUNT. Добавление, удаление и слияние не выделяют память
+class LatencyHistogram {
+public:
+    void Add(uint64_t nanoseconds);
+
+    // nanoseconds должно быть добавлено раньше
+    void Remove(uint64_t nanoseconds);
+
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t GetCount() const;
+
+    // Граница, не больше которой не меньше доли quantile значений (quantile от 0 до 1), 0 у пустой гистограммы
+    uint64_t GetPercentile(double quantile) const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    std::array<uint64_t, BUCKET_COUNT> bucket_counts_{};
+    uint64_t count_ = 0;
+
+    static size_t GetBucket(uint64_t nanoseconds);
+
+    static uint64_t GetBucketUpperBound(size_t bucket);
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Живые внутренние номера документов в порядке выдачи. Над отметками живости построено дерево
+// Фенвика, поэтому номер документа по его позиции среди живых ищется за O(log n), а добавление
+// и удаление номера тоже стоят O(log n)
+class LiveOrdinals {
+public:
+    // Добавляет живой номер, равный текущему GetOrdinalCount()
+    void PushBack() {
+        is_live_.push_back(true);
+        // Узел i покрывает номера (i - lowbit(i), i]: новый номер плюс уже посчитанные младшие узлы
+        const size_t node = is_live_.size();
+        int sum = 1;
+        for (size_t child = node - 1; child > node - LowBit(node); child -= LowBit(child)) {
+            sum += tree_[child - 1];
+        }
+        tree_.push_back(sum);
+        ++live_count_;
+    }
+
+    void Erase(int ordinal) {
+        if (!is_live_[ordinal]) {
+            return;
+        }
+        is_live_[ordinal] = false;
+        for (size_t node = ordinal + 1; node <= tree_.size(); node += LowBit(node)) {
+            --tree_[node - 1];
+        }
+        --live_count_;
+    }
+
+    bool IsLive(int ordinal) const {
+        return is_live_[ordinal];
+    }
+
+    // Число выданных номеров вместе с удалёнными
+    size_t GetOrdinalCount() const {
+        return is_live_.size();
+    }
+
+    size_t GetLiveCount() const {
+        return live_count_;
+    }
+
+    // Номер, перед которым ровно index живых номеров; index меньше GetLiveCount()
+    int FindByIndex(size_t index) const {
+        size_t node = 0;
+        size_t step = 1;
+        while (step * 2 <= tree_.size()) {
+            step *= 2;
+        }
+        for (; step > 0; step /= 2) {
+            if (node + step <= tree_.size() && static_cast<size_t>(tree_[node + step - 1]) <= index) {
+                node += step;
+                index -= tree_[node - 1];
+            }
+        }
+        return static_cast<int>(node);
+    }
+
+private:
+    std::vector<bool> is_live_;
+    // tree_[i - 1] — число живых номеров в (i - lowbit(i), i]
+    std::vector<int> tree_;
+    size_t live_count_ = 0;
+
+    static size_t LowBit(size_t node) {
+        return node & (~node + 1);
+    }
+};
@@ -1,14 +1,28 @@
 #include "search_server.h"
 #include "log_duration.h"
 
+#include <chrono>
 #include <iostream>
 #include <execution>
+#include <numeric>
+#include <filesystem>
+#include <fstream>
 #include <random>
 #include <string>
+#include <thread>
 #include <vector>
+#include "latency_histogram.h"
+#include "mapped_search_server.h"
+#include "query_cache.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
+#include "segmented_search_server.h"
+#include "stage_latency.h"
 #include "test_example_functions.h"
 #include "process_queries.h"
 
+#include <unistd.h>
+
 
 using namespace std;
 
@@ -71,9 +85,952 @@ Test(string_view mark, const SearchServer& search_server, const vector<string>&
 
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
-int main() {
+void BenchmarkFindTopDocuments() {
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+
+    SearchServer search_server(dictionary[0]);
+    {
+        LOG_DURATION("AddDocument"sv);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+
+    const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+
+    TEST(seq);
+    TEST(par);
+}
+
+vector<Document> GenerateDocuments(mt19937& generator, int document_count) {
+    vector<Document> documents;
+    documents.reserve(document_count);
+    for (int id = 0; id < document_count; ++id) {
+        documents.emplace_back(id, uniform_real_distribution<>(0, 1)(generator),
+                               uniform_int_distribution(-10, 10)(generator));
+    }
+    return documents;
+}
+
+void BenchmarkSelectTopDocuments() {
+    mt19937 generator;
+    for (const int document_count : {1'000, 10'000, 100'000, 1'000'000}) {
+        const auto documents = GenerateDocuments(generator, document_count);
+        const int repeat_count = 10'000'000 / document_count;
+        cout << document_count << " documents x "s << repeat_count << ":"s << endl;
+        {
+            LOG_DURATION("  full sort"sv);
+            for (int i = 0; i < repeat_count; ++i) {
+                auto copy = documents;
+                sort(copy.begin(), copy.end(), IsMoreRelevant);
+                copy.resize(MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+        {
+            LOG_DURATION("  top-K seq"sv);
+            for (int i = 0; i < repeat_count; ++i) {
+                auto copy = documents;
+                SelectTopDocuments(execution::seq, copy, MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+        {
+            LOG_DURATION("  top-K par"sv);
+            for (int i = 0; i < repeat_count; ++i) {
+                auto copy = documents;
+                SelectTopDocuments(execution::par, copy, MAX_RESULT_DOCUMENT_COUNT);
+            }
+        }
+    }
+}
+
+// Резидентная память процесса в байтах, 0 если её не удалось узнать
+size_t GetResidentMemory() {
+    ifstream statm("/proc/self/statm"s);
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void BenchmarkIndexMemory() {
+    mt19937 generator;
+    const int document_count = 1'000'000;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+
+    const size_t memory_before = GetResidentMemory();
+    SearchServer search_server(dictionary[0]);
+    size_t posting_count = 0;
+    {
+        LOG_DURATION("AddDocument 1M"sv);
+        for (int id = 0; id < document_count; ++id) {
+            const string document = GenerateQuery(generator, dictionary, 20);
+            search_server.AddDocument(id, document, DocumentStatus::ACTUAL, {1, 2, 3});
+            auto words = SplitIntoWords(document);
+            words.erase(remove(words.begin(), words.end(), dictionary[0]), words.end());
+            sort(words.begin(), words.end());
+            posting_count += unique(words.begin(), words.end()) - words.begin();
+        }
+    }
+    const size_t index_memory = GetResidentMemory() - memory_before;
+    cout << "index: "s << index_memory / (1 << 20) << " MB, "s
+         << index_memory / document_count << " bytes per document, "s
+         << double(index_memory) / posting_count << " bytes per posting ("s << posting_count << " postings)"s << endl;
+}
+
+// Удаление постинга перекодирует один блок, поэтому его скорость не зависит от длины списка
+void BenchmarkPostingListErase() {
+    mt19937 generator;
+    const int erase_count = 20'000;
+    for (const int posting_count : {10'000, 100'000, 1'000'000}) {
+        PostingList postings;
+        vector<int> ordinals;
+        for (int ordinal = 0; static_cast<int>(ordinals.size()) < posting_count;
+             ordinal += uniform_int_distribution(1, 20)(generator)) {
+            postings.PushBack(ordinal, uniform_int_distribution(1, 5)(generator));
+            ordinals.push_back(ordinal);
+        }
+        shuffle(ordinals.begin(), ordinals.end(), generator);
+        const int erased_count = min(erase_count, posting_count / 2);
+        const auto start_time = chrono::steady_clock::now();
+        for (int i = 0; i < erased_count; ++i) {
+            postings.Erase(ordinals[i]);
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << "PostingList::Erase, "s << posting_count << " postings: "s
+             << erased_count / duration.count() << " postings/s"s << endl;
+    }
+}
+
+void BenchmarkRemoveDocument() {
+    mt19937 generator;
+    const int document_count = 20'000;
+    for (const int word_count : {1'000, 10'000, 100'000}) {
+        const auto dictionary = GenerateDictionary(generator, word_count, 10);
+        SearchServer search_server(dictionary[0]);
+        for (int id = 0; id < document_count; ++id) {
+            search_server.AddDocument(id, GenerateQuery(generator, dictionary, 20), DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const auto start_time = chrono::steady_clock::now();
+        for (int id = 0; id < document_count; ++id) {
+            search_server.RemoveDocument(id);
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << "RemoveDocument, "s << dictionary.size() << " words: "s
+             << document_count / duration.count() << " documents/s"s << endl;
+    }
+}
+
+// Время выполнения запросов в микросекундах, пока stop ложно
+vector<double> MeasureQueryLatencies(const SegmentedSearchServer& search_server, const vector<string>& queries,
+                                     const atomic_bool& stop) {
+    vector<double> latencies;
+    for (size_t i = 0; !stop; ++i) {
+        const auto start_time = chrono::steady_clock::now();
+        search_server.FindTopDocuments(queries[i % queries.size()]);
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count());
+    }
+    return latencies;
+}
+
+void PrintLatencies(string_view mark, vector<double> latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    sort(latencies.begin(), latencies.end());
+    cout << mark << ": "s << latencies.size() << " queries, p50 "s << latencies[latencies.size() / 2] << " us, p99 "s
+         << latencies[latencies.size() * 99 / 100] << " us"s << endl;
+}
+
+void BenchmarkIngestion() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 200'000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 100, 5);
+
+    {
+        SearchServer search_server(dictionary[0]);
+        const auto start_time = chrono::steady_clock::now();
+        for (size_t id = 0; id < documents.size(); ++id) {
+            search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << "SearchServer ingest: "s << documents.size() / duration.count() << " documents/s"s << endl;
+    }
+    {
+        SegmentedSearchServer search_server{SearchServer(dictionary[0])};
+        const auto start_time = chrono::steady_clock::now();
+        for (size_t id = 0; id < documents.size(); ++id) {
+            search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        search_server.Flush();
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        search_server.WaitForCompaction();
+        const chrono::duration<double> compaction_duration = chrono::steady_clock::now() - start_time;
+        cout << "SegmentedSearchServer ingest: "s << documents.size() / duration.count() << " documents/s, "s
+             << documents.size() / compaction_duration.count() << " documents/s including compaction"s << endl;
+    }
+    {
+        SegmentedSearchServer search_server{SearchServer(dictionary[0])};
+        const size_t half = documents.size() / 2;
+        for (size_t id = 0; id < half; ++id) {
+            search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        search_server.Flush();
+        search_server.WaitForCompaction();
+
+        atomic_bool measure_done = false;
+        thread idle_reader([&] {
+            PrintLatencies("SegmentedSearchServer queries without ingest"sv,
+                           MeasureQueryLatencies(search_server, queries, measure_done));
+        });
+        this_thread::sleep_for(chrono::seconds(2));
+        measure_done = true;
+        idle_reader.join();
+
+        // Вторая половина корпуса загружается, пока читатель выполняет запросы
+        atomic_bool ingest_done = false;
+        thread reader([&] {
+            PrintLatencies("SegmentedSearchServer queries during ingest"sv,
+                           MeasureQueryLatencies(search_server, queries, ingest_done));
+        });
+        const auto start_time = chrono::steady_clock::now();
+        for (size_t id = half; id < documents.size(); ++id) {
+            search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        search_server.Flush();
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        ingest_done = true;
+        reader.join();
+        cout << "SegmentedSearchServer ingest with a concurrent reader: "s
+             << (documents.size() - half) / duration.count() << " documents/s"s << endl;
+    }
+}
+
+void BenchmarkBulkLoad() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto texts = GenerateQueries(generator, dictionary, 500'000, 70);
+    vector<NewDocument> documents;
+    documents.reserve(texts.size());
+    for (size_t id = 0; id < texts.size(); ++id) {
+        documents.push_back({static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, {1, 2, 3}});
+    }
+
+    const auto measure = [&](string_view mark, const auto& load) {
+        SearchServer search_server(dictionary[0]);
+        const auto start_time = chrono::steady_clock::now();
+        load(search_server);
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << documents.size() / duration.count() << " documents/s"s << endl;
+    };
+    measure("AddDocument loop"sv, [&](SearchServer& search_server) {
+        for (const NewDocument& document : documents) {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+    });
+    measure("AddDocuments seq"sv, [&](SearchServer& search_server) {
+        search_server.AddDocuments(execution::seq, documents);
+    });
+    measure("AddDocuments par"sv, [&](SearchServer& search_server) {
+        search_server.AddDocuments(execution::par, documents);
+    });
+}
+
+void BenchmarkIndexFile() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 500'000, 20);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 5);
+    const string path = (filesystem::temp_directory_path() / "search_server_benchmark.idx").string();
+
+    const auto measure_queries = [&](const auto& search_server) {
+        const auto start_time = chrono::steady_clock::now();
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+    };
+
+    {
+        const size_t memory_before = GetResidentMemory();
+        const auto start_time = chrono::steady_clock::now();
+        SearchServer search_server(dictionary[0]);
+        for (size_t id = 0; id < documents.size(); ++id) {
+            search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        const chrono::duration<double, milli> duration = chrono::steady_clock::now() - start_time;
+        const size_t memory = GetResidentMemory() - memory_before;
+        const double query_duration = measure_queries(search_server);
+        cout << "rebuild: "s << duration.count() << " ms, "s << memory / (1 << 20) << " MB RSS, "s
+             << queries.size() << " queries in "s << query_duration << " ms"s << endl;
+        SaveIndex(search_server, path);
+    }
+    {
+        const size_t memory_before = GetResidentMemory();
+        const auto start_time = chrono::steady_clock::now();
+        const MappedSearchServer search_server(path);
+        const chrono::duration<double, milli> duration = chrono::steady_clock::now() - start_time;
+        const size_t memory = GetResidentMemory() - memory_before;
+        const double query_duration = measure_queries(search_server);
+        cout << "mmap open: "s << duration.count() << " ms, "s << memory / (1 << 20) << " MB RSS, "s
+             << queries.size() << " queries in "s << query_duration << " ms, "s
+             << (GetResidentMemory() - memory_before) / (1 << 20) << " MB RSS after queries ("s
+             << filesystem::file_size(path) / (1 << 20) << " MB file)"s << endl;
+        // Полная проверка читает весь файл, поэтому измеряется отдельно от открытия
+        const auto validate_start_time = chrono::steady_clock::now();
+        search_server.Validate();
+        const chrono::duration<double, milli> validate_duration = chrono::steady_clock::now() - validate_start_time;
+        cout << "validate: "s << validate_duration.count() << " ms, "s
+             << (GetResidentMemory() - memory_before) / (1 << 20) << " MB RSS after validation"s << endl;
+    }
+    filesystem::remove(path);
+}
+
+void BenchmarkQueryCache() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 100'000, 70);
+    const auto distinct_queries = GenerateQueries(generator, dictionary, 1'000, 5);
+    SearchServer search_server(dictionary[0]);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    // Популярность запросов убывает по закону Ципфа
+    vector<double> weights;
+    for (size_t i = 1; i <= distinct_queries.size(); ++i) {
+        weights.push_back(1.0 / i);
+    }
+    discrete_distribution<size_t> query_distribution(weights.begin(), weights.end());
+    vector<string> queries;
+    for (int i = 0; i < 10'000; ++i) {
+        queries.push_back(distinct_queries[query_distribution(generator)]);
+    }
+
+    {
+        LOG_DURATION("FindTopDocuments without cache"sv);
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    }
+    QueryCache cache(256);
+    {
+        LOG_DURATION("FindTopDocuments with cache"sv);
+        for (const string& query : queries) {
+            cache.FindTopDocuments(search_server, query);
+        }
+    }
+    const auto stats = cache.GetStats();
+    cout << "cache: hit rate "s << stats.hit_rate << ", hit "s << stats.average_hit_latency.count() << " ns, miss "s
+         << stats.average_miss_latency.count() << " ns"s << endl;
+}
+
+void BenchmarkTokenize() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    // Тексты размером с документы корпуса, загрузка разбирает именно такие
+    const auto documents = GenerateQueries(generator, dictionary, 100'000, 70);
+    const int repeat_count = 10;
+    size_t byte_count = 0;
+    for (const string& document : documents) {
+        byte_count += document.size();
+    }
+    const double gigabytes = double(byte_count) * repeat_count / 1e9;
+
+    {
+        // Прежний разбор: пробелы по одному через find, затем каждое слово проверяется отдельно
+        const auto start_time = chrono::steady_clock::now();
+        size_t valid_count = 0;
+        for (int i = 0; i < repeat_count; ++i) {
+            for (const string& document : documents) {
+                vector<string_view> words;
+                string_view rest = document;
+                while (true) {
+                    const size_t space = rest.find(' ');
+                    words.push_back(rest.substr(0, space));
+                    if (space == rest.npos) {
+                        break;
+                    }
+                    rest.remove_prefix(space + 1);
+                }
+                valid_count += all_of(words.begin(), words.end(), [](string_view word) {
+                    return none_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; });
+                });
+            }
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << "find + IsValidWord: "s << gigabytes / duration.count() << " GB/s ("s << valid_count << " valid)"s
+             << endl;
+    }
+    {
+        const auto start_time = chrono::steady_clock::now();
+        size_t valid_count = 0;
+        for (int i = 0; i < repeat_count; ++i) {
+            for (const string& document : documents) {
+                const auto tokenized = Tokenize(document);
+                valid_count += tokenized.first_invalid_word == tokenized.words.size();
+            }
+        }
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        cout << "Tokenize: "s << gigabytes / duration.count() << " GB/s ("s << valid_count << " valid)"s << endl;
+    }
+}
+
+// Частоты слов убывают по закону Ципфа: слово с номером i встречается в 1 / (i + 1) раз реже первого
+string GenerateZipfText(mt19937& generator, const vector<string>& dictionary, int word_count,
+                        string_view word_prefix = {}) {
+    static discrete_distribution<size_t> word_distribution;
+    if (word_distribution.probabilities().size() != dictionary.size()) {
+        vector<double> weights;
+        for (size_t i = 1; i <= dictionary.size(); ++i) {
+            weights.push_back(1.0 / i);
+        }
+        word_distribution = discrete_distribution<size_t>(weights.begin(), weights.end());
+    }
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += word_prefix;
+        text += dictionary[word_distribution(generator)];
+    }
+    return text;
+}
+
+SearchServer GenerateZipfServer(mt19937& generator, const vector<string>& dictionary, int document_count) {
+    SearchServer search_server(""s);
+    for (int id = 0; id < document_count; ++id) {
+        search_server.AddDocument(id, GenerateZipfText(generator, dictionary, 70), DocumentStatus::ACTUAL,
+                                  {1, 2, 3});
+    }
+    return search_server;
+}
+
+void BenchmarkDynamicPruning() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const int document_count = 100'000;
+    const SearchServer search_server = GenerateZipfServer(generator, dictionary, document_count);
+    for (const int word_count : {2, 4, 8}) {
+        vector<string> queries;
+        for (int i = 0; i < 200; ++i) {
+            queries.push_back(GenerateZipfText(generator, dictionary, word_count));
+        }
+        const auto measure = [&](string_view mark, size_t top_count) {
+            const auto start_time = chrono::steady_clock::now();
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                const auto documents = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_count);
+                for (size_t i = 0; i < min(documents.size(), size_t(MAX_RESULT_DOCUMENT_COUNT)); ++i) {
+                    total_relevance += documents[i].relevance;
+                }
+            }
+            const chrono::duration<double, micro> duration = chrono::steady_clock::now() - start_time;
+            cout << word_count << " words, "s << mark << ": "s << duration.count() / queries.size()
+                 << " us/query ("s << total_relevance << ")"s << endl;
+        };
+        // Когда нужны все документы, сервер оценивает все постинги без отсечения
+        measure("exhaustive"sv, document_count);
+        measure("MaxScore top-5"sv, MAX_RESULT_DOCUMENT_COUNT);
+    }
+}
+
+void BenchmarkMinusWords() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const SearchServer search_server = GenerateZipfServer(generator, dictionary, 100'000);
+    // Минус-слова берутся из того же распределения, поэтому среди них много частых
+    for (const int minus_word_count : {0, 2, 8}) {
+        vector<string> queries;
+        for (int i = 0; i < 200; ++i) {
+            string query = GenerateZipfText(generator, dictionary, 3);
+            if (minus_word_count > 0) {
+                query += " "s + GenerateZipfText(generator, dictionary, minus_word_count, "-"sv);
+            }
+            queries.push_back(move(query));
+        }
+        for (const bool is_parallel : {false, true}) {
+            const auto start_time = chrono::steady_clock::now();
+            size_t result_count = 0;
+            for (const string& query : queries) {
+                result_count += is_parallel ? search_server.FindTopDocuments(execution::par, query).size()
+                                            : search_server.FindTopDocuments(execution::seq, query).size();
+            }
+            const chrono::duration<double, micro> duration = chrono::steady_clock::now() - start_time;
+            cout << minus_word_count << " minus words, "s << (is_parallel ? "par"s : "seq"s) << ": "s
+                 << duration.count() / queries.size() << " us/query ("s << result_count << " results)"s << endl;
+        }
+    }
+}
+
+void BenchmarkProcessQueries() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const SearchServer search_server = GenerateZipfServer(generator, dictionary, 20'000);
+    vector<string> queries;
+    for (int i = 0; i < 10'000; ++i) {
+        queries.push_back(GenerateZipfText(generator, dictionary, 5));
+    }
+    const auto measure = [&queries](string_view mark, const auto& process) {
+        const auto start_time = chrono::steady_clock::now();
+        const auto results = process();
+        const chrono::duration<double> duration = chrono::steady_clock::now() - start_time;
+        double total_relevance = 0;
+        for (const auto& documents : results) {
+            for (const Document& document : documents) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << mark << ": "s << queries.size() / duration.count() << " queries/s ("s << total_relevance << ")"s
+             << endl;
+    };
+    // Прежняя схема: каждый запрос ищется отдельно, разбиение работы — на усмотрение библиотеки
+    measure("transform par + FindTopDocuments"sv, [&] {
+        vector<vector<Document>> results(queries.size());
+        transform(execution::par, queries.begin(), queries.end(), results.begin(), [&](const string& query) {
+            return search_server.FindTopDocuments(query);
+        });
+        return results;
+    });
+    measure("ProcessQueries"sv, [&] {
+        return ProcessQueries(search_server, queries);
+    });
+}
+
+void BenchmarkProcessQueriesJoined() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+    const SearchServer search_server = GenerateZipfServer(generator, dictionary, 20'000);
+    vector<string> queries;
+    for (int i = 0; i < 100'000; ++i) {
+        queries.push_back(GenerateZipfText(generator, dictionary, 5));
+    }
+    const auto measure = [&queries](string_view mark, const auto& make_documents) {
+        const size_t memory_before = GetResidentMemory();
+        const auto start_time = chrono::steady_clock::now();
+        double first_document_ms = 0;
+        size_t document_count = 0;
+        double total_relevance = 0;
+        auto documents = make_documents();
+        for (const Document& document : documents) {
+            if (document_count++ == 0) {
+                first_document_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+            }
+            total_relevance += document.relevance;
+        }
+        const chrono::duration<double, milli> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": first document after "s << first_document_ms << " ms, all "s << document_count
+             << " in "s << duration.count() << " ms, +"s << (GetResidentMemory() - memory_before) / 1024
+             << " KB RSS ("s << total_relevance << ")"s << endl;
+    };
+    // Прежняя схема: все результаты собираются в вектор векторов и копируются в общий вектор
+    measure("ProcessQueries + join"sv, [&] {
+        vector<Document> joined;
+        for (const auto& documents : ProcessQueries(search_server, queries)) {
+            joined.insert(joined.end(), documents.begin(), documents.end());
+        }
+        return joined;
+    });
+    measure("ProcessQueriesJoined"sv, [&] {
+        return ProcessQueriesJoined(search_server, queries);
+    });
+}
+
+void BenchmarkRequestQueue() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    search_server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, {1, 2, 8});
+    const vector<string> queries = {"curly dog"s, "funny pet"s, "sparrow"s, "nasty hair cat"s};
+    const int request_count = 1'000'000;
+    RequestQueue request_queue(search_server);
+    const auto start_time = chrono::steady_clock::now();
+    for (int i = 0; i < request_count; ++i) {
+        request_queue.AddFindRequest(queries[i % queries.size()]);
+    }
+    const chrono::duration<double, nano> duration = chrono::steady_clock::now() - start_time;
+    cout << "AddFindRequest: "s << duration.count() / request_count << " ns/request, "s
+         << request_queue.GetNoResultRequests() << " without results"s << endl;
+}
+
+void BenchmarkRemoveDuplicates() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const int document_count = 100'000;
+    // Каждый десятый документ повторяет слова одного из предыдущих в другом порядке
+    vector<string> texts;
+    for (int id = 0; id < document_count; ++id) {
+        if (id % 10 == 9) {
+            const string& original = texts[uniform_int_distribution(0, id - 1)(generator)];
+            vector<string_view> words = SplitIntoWords(original);
+            shuffle(words.begin(), words.end(), generator);
+            string text;
+            for (const string_view word : words) {
+                text += string(word) + " "s;
+            }
+            text.pop_back();
+            texts.push_back(move(text));
+        } else {
+            texts.push_back(GenerateZipfText(generator, dictionary, 70));
+        }
+    }
+    SearchServer source_server(""s);
+    for (int id = 0; id < document_count; ++id) {
+        source_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const auto measure = [&source_server](string_view mark, const auto& remove) {
+        SearchServer search_server = source_server;
+        const auto start_time = chrono::steady_clock::now();
+        const size_t removed_count = remove(search_server);
+        const chrono::duration<double, milli> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << duration.count() << " ms, "s << removed_count << " removed"s << endl;
+    };
+    SearchServer probe_server = source_server;
+    const auto duplicate_ids = RemoveDuplicates(probe_server);
+    // Прежняя схема удаления: постинги перекодируются после каждого документа. Поиск дубликатов не учтён
+    measure("RemoveDocument one by one"sv, [&duplicate_ids](SearchServer& search_server) {
+        for (const int id : duplicate_ids) {
+            search_server.RemoveDocument(id);
+        }
+        return duplicate_ids.size();
+    });
+    measure("RemoveDuplicates seq"sv, [](SearchServer& search_server) {
+        return RemoveDuplicates(search_server).size();
+    });
+    measure("RemoveDuplicates par"sv, [](SearchServer& search_server) {
+        return RemoveDuplicates(execution::par, search_server).size();
+    });
+    measure("RemoveNearDuplicates par"sv, [](SearchServer& search_server) {
+        return RemoveNearDuplicates(execution::par, search_server, 0.8).size();
+    });
+}
+
+void BenchmarkWordFrequencies() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    SearchServer search_server = GenerateZipfServer(generator, dictionary, 100'000);
+    const auto measure = [&search_server](string_view mark, const auto& sum_frequencies) {
+        const auto start_time = chrono::steady_clock::now();
+        double total_frequency = 0;
+        for (const int document_id : search_server) {
+            total_frequency += sum_frequencies(search_server.GetWordFrequencies(document_id));
+        }
+        const chrono::duration<double, nano> duration = chrono::steady_clock::now() - start_time;
+        cout << mark << ": "s << duration.count() / search_server.GetDocumentCount() << " ns/document ("s
+             << total_frequency << ")"s << endl;
+    };
+    // Прежняя цена вызова: слова документа копировались в std::map
+    measure("copy to map"sv, [](const SearchServer::WordFrequencies& word_frequencies) {
+        const map<string_view, double> frequencies(word_frequencies.begin(), word_frequencies.end());
+        double total_frequency = 0;
+        for (const auto& [word, frequency] : frequencies) {
+            total_frequency += frequency;
+        }
+        return total_frequency;
+    });
+    measure("view"sv, [](const SearchServer::WordFrequencies& word_frequencies) {
+        double total_frequency = 0;
+        for (const auto [word, frequency] : word_frequencies) {
+            total_frequency += frequency;
+        }
+        return total_frequency;
+    });
+}
+
+// Без флага SEARCH_SERVER_METRICS гистограммы пусты, сравнение времени двух сборок показывает цену замеров
+void BenchmarkStageLatencies() {
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const SearchServer search_server = GenerateZipfServer(generator, dictionary, 100'000);
+    vector<string> queries;
+    for (int i = 0; i < 1'000; ++i) {
+        queries.push_back(GenerateZipfText(generator, dictionary, 3) + " "s
+                          + GenerateZipfText(generator, dictionary, 1, "-"sv));
+    }
+    ResetStageLatencies();
+    const auto start_time = chrono::steady_clock::now();
+    size_t result_count = 0;
+    for (const string& query : queries) {
+        result_count += search_server.FindTopDocuments(query).size();
+    }
+    const chrono::duration<double, micro> duration = chrono::steady_clock::now() - start_time;
+    cout << "FindTopDocuments: "s << duration.count() / queries.size() << " us/query ("s
+         << result_count << " results)"s << endl;
+    cout << DumpStageLatenciesText();
+}
+
+// Параметры набора --benchmark-suite. Корпус и запросы зависят только от seed, поэтому
+// прогоны с одинаковыми параметрами сравнимы между собой
+struct SuiteScale {
+    string_view name;
+    int document_count;
+    // Запросов на каждую операцию поиска, на больших корпусах один запрос намного дороже
+    int query_count;
+};
+
+constexpr SuiteScale SUITE_SCALES[] = {
+        {"10k"sv, 10'000, 1'000},
+        {"1m"sv, 1'000'000, 200},
+        {"10m"sv, 10'000'000, 50},
+};
+
+struct SuiteConfig {
+    SuiteScale scale = SUITE_SCALES[0];
+    double minus_prob = 0.1;
+    uint32_t seed = 1;
+};
+
+constexpr int SUITE_DICTIONARY_SIZE = 20'000;
+constexpr int SUITE_DOCUMENT_WORD_COUNT = 70;
+constexpr int SUITE_QUERY_WORD_COUNT = 3;
+constexpr size_t SUITE_QUERY_BATCH_SIZE = 100;
+
+// Слова запроса из распределения Ципфа, каждое с вероятностью minus_prob становится минус-словом
+string GenerateZipfQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        const bool is_minus = bernoulli_distribution(minus_prob)(generator);
+        query += GenerateZipfText(generator, dictionary, 1, is_minus ? "-"sv : ""sv);
+    }
+    return query;
+}
+
+// Задержки отдельных операций одного замера. Пропускная способность считается по суммарному
+// времени операций, подготовка данных между ними не учитывается
+class SuiteBenchmark {
+public:
+    explicit SuiteBenchmark(string_view name) : name_(name) {
+    }
+
+    // Возвращает результат operation, чтобы его можно было учесть в контрольной сумме
+    template<typename Operation>
+    auto Time(Operation operation) {
+        const auto start_time = chrono::steady_clock::now();
+        auto result = operation();
+        const auto nanoseconds = chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - start_time).count();
+        histogram_.Add(nanoseconds);
+        total_nanoseconds_ += nanoseconds;
+        return result;
+    }
+
+    // Одна строка JSON. checksum совпадает у прогонов с одинаковыми параметрами
+    void Print(const SuiteConfig& config, uint64_t checksum) const {
+        const uint64_t operation_count = histogram_.GetCount();
+        const double ops_per_second = total_nanoseconds_ > 0 ? operation_count * 1e9 / total_nanoseconds_ : 0;
+        cout << "{\"benchmark\":\""s << name_ << "\",\"scale\":\""s << config.scale.name
+             << "\",\"documents\":"s << config.scale.document_count << ",\"minus_prob\":"s << config.minus_prob
+             << ",\"seed\":"s << config.seed << ",\"operations\":"s << operation_count
+             << ",\"ops_per_second\":"s << ops_per_second << ",\"p50_ns\":"s << histogram_.GetPercentile(0.5)
+             << ",\"p99_ns\":"s << histogram_.GetPercentile(0.99) << ",\"checksum\":"s << checksum << "}"s
+             << endl;
+    }
+
+private:
+    string_view name_;
+    LatencyHistogram histogram_;
+    uint64_t total_nanoseconds_ = 0;
+};
+
+void RunBenchmarkSuite(const SuiteConfig& config) {
+    mt19937 generator(config.seed);
+    const auto dictionary = GenerateDictionary(generator, SUITE_DICTIONARY_SIZE, 10);
+    const int document_count = config.scale.document_count;
+
+    SearchServer search_server(""s);
+    // Копии первых документов добавляются перед замером RemoveDuplicates
+    vector<string> duplicated_texts;
+    {
+        SuiteBenchmark benchmark("add_document"sv);
+        for (int id = 0; id < document_count; ++id) {
+            string text = GenerateZipfText(generator, dictionary, SUITE_DOCUMENT_WORD_COUNT);
+            benchmark.Time([&] {
+                search_server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2, 3});
+                return 0;
+            });
+            if (id < config.scale.query_count) {
+                duplicated_texts.push_back(move(text));
+            }
+        }
+        benchmark.Print(config, search_server.GetDocumentCount());
+    }
+
+    vector<string> queries;
+    for (int i = 0; i < config.scale.query_count; ++i) {
+        queries.push_back(GenerateZipfQuery(generator, dictionary, SUITE_QUERY_WORD_COUNT, config.minus_prob));
+    }
+    vector<int> document_ids;
+    for (int i = 0; i < config.scale.query_count; ++i) {
+        document_ids.push_back(uniform_int_distribution(0, document_count - 1)(generator));
+    }
+
+    const auto find_top_documents = [&](string_view name, const auto& policy) {
+        SuiteBenchmark benchmark(name);
+        uint64_t checksum = 0;
+        for (const string& query : queries) {
+            const auto documents = benchmark.Time([&] {
+                return search_server.FindTopDocuments(policy, query);
+            });
+            for (const Document& document : documents) {
+                checksum += document.id;
+            }
+        }
+        benchmark.Print(config, checksum);
+    };
+    find_top_documents("find_top_documents_seq"sv, execution::seq);
+    find_top_documents("find_top_documents_par"sv, execution::par);
+
+    const auto match_document = [&](string_view name, const auto& policy) {
+        SuiteBenchmark benchmark(name);
+        uint64_t checksum = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto [words, status] = benchmark.Time([&] {
+                return search_server.MatchDocument(policy, queries[i], document_ids[i]);
+            });
+            checksum += words.size();
+        }
+        benchmark.Print(config, checksum);
+    };
+    match_document("match_document_seq"sv, execution::seq);
+    match_document("match_document_par"sv, execution::par);
+
+    {
+        // Одна операция — пачка запросов
+        SuiteBenchmark benchmark("process_queries"sv);
+        uint64_t checksum = 0;
+        for (size_t begin = 0; begin < queries.size(); begin += SUITE_QUERY_BATCH_SIZE) {
+            const vector<string> batch(queries.begin() + begin,
+                                       queries.begin() + min(queries.size(), begin + SUITE_QUERY_BATCH_SIZE));
+            const auto results = benchmark.Time([&] {
+                return ProcessQueries(search_server, batch);
+            });
+            for (const auto& documents : results) {
+                for (const Document& document : documents) {
+                    checksum += document.id;
+                }
+            }
+        }
+        benchmark.Print(config, checksum);
+    }
+
+    {
+        for (size_t i = 0; i < duplicated_texts.size(); ++i) {
+            search_server.AddDocument(document_count + i, duplicated_texts[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        // Одна операция — проход по всему корпусу
+        SuiteBenchmark benchmark("remove_duplicates"sv);
+        const auto duplicate_ids = benchmark.Time([&] {
+            return RemoveDuplicates(execution::par, search_server);
+        });
+        benchmark.Print(config, duplicate_ids.size());
+    }
+
+    {
+        // Удаление последним: остальные замеры идут на полном корпусе
+        vector<int> removed_ids(document_count);
+        iota(removed_ids.begin(), removed_ids.end(), 0);
+        shuffle(removed_ids.begin(), removed_ids.end(), generator);
+        removed_ids.resize(min(removed_ids.size(), size_t(config.scale.query_count)));
+        SuiteBenchmark benchmark("remove_document"sv);
+        for (const int id : removed_ids) {
+            benchmark.Time([&] {
+                search_server.RemoveDocument(id);
+                return 0;
+            });
+        }
+        benchmark.Print(config, search_server.GetDocumentCount());
+    }
+}
+
+// Аргументы после --benchmark-suite: [10k|1m|10m] [вероятность минус-слова] [seed]
+SuiteConfig ParseSuiteConfig(int argc, char* argv[]) {
+    SuiteConfig config;
+    if (argc > 2) {
+        const auto scale = find_if(begin(SUITE_SCALES), end(SUITE_SCALES), [&](const SuiteScale& scale) {
+            return scale.name == argv[2];
+        });
+        if (scale == end(SUITE_SCALES)) {
+            throw invalid_argument("Unknown benchmark scale "s + argv[2]);
+        }
+        config.scale = *scale;
+    }
+    if (argc > 3) {
+        config.minus_prob = stod(argv[3]);
+        if (config.minus_prob < 0 || config.minus_prob > 1) {
+            throw invalid_argument("Minus word probability must be between 0 and 1"s);
+        }
+    }
+    if (argc > 4) {
+        config.seed = stoul(argv[4]);
+    }
+    return config;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && argv[1] == "--benchmark-suite"sv) {
+        try {
+            RunBenchmarkSuite(ParseSuiteConfig(argc, argv));
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc > 1 && argv[1] == "--benchmark"sv) {
+        BenchmarkFindTopDocuments();
+        BenchmarkSelectTopDocuments();
+        BenchmarkIndexMemory();
+        BenchmarkPostingListErase();
+        BenchmarkRemoveDocument();
+        BenchmarkIngestion();
+        BenchmarkBulkLoad();
+        BenchmarkIndexFile();
+        BenchmarkQueryCache();
+        BenchmarkTokenize();
+        BenchmarkDynamicPruning();
+        BenchmarkMinusWords();
+        BenchmarkProcessQueries();
+        BenchmarkProcessQueriesJoined();
+        BenchmarkRequestQueue();
+        BenchmarkStageLatencies();
+        BenchmarkRemoveDuplicates();
+        BenchmarkWordFrequencies();
+        return 0;
+    }
     TestProcessQueries();
     TestProcessQueriesJoined();
     TestRemoveFunction();
     TestMatchDocument();
+    TestParallelFindTopDocuments();
+    TestSelectTopDocuments();
+    TestTermDictionary();
+    TestRemoveDocumentKeepsIndexConsistent();
+    TestRemovedOrdinalsAreCompacted();
+    TestConcurrentMatchDocument();
+    TestSnapshotSearchServer();
+    TestSegmentedSearchServer();
+    TestAddDocuments();
+    TestMappedSearchServer();
+    TestPostingList();
+    TestQueryCache();
+    TestQueryParsingDoesNotAllocate();
+    TestTokenize();
+    TestInverseDocumentFreqCache();
+    TestDynamicPruning();
+    TestMinusWordsExcludeDocuments();
+    TestProcessQueriesBatch();
+    TestProcessQueriesJoinedIsLazy();
+    TestRequestQueueWindow();
+    TestStageLatencies();
+    TestRemoveDuplicates();
+    TestWordFrequencies();
+    TestWorkStealingPoolReuse();
 }
\ No newline at end of file
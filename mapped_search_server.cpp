@@ -0,0 +1,426 @@
+#include "mapped_search_server.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char INDEX_FILE_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr size_t SECTION_ALIGNMENT = 8;
+
+size_t AlignSize(size_t size) {
+    return (size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+class IndexWriter {
+public:
+    explicit IndexWriter(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc) {
+        if (!out_) {
+            throw std::runtime_error("Cannot create index file " + path);
+        }
+    }
+
+    // Секция дополняется нулями до выравнивания
+    void Write(const void* data, size_t size) {
+        static constexpr char padding[SECTION_ALIGNMENT] = {};
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        out_.write(padding, static_cast<std::streamsize>(AlignSize(size) - size));
+    }
+
+    template<typename T>
+    void Write(const std::vector<T>& section) {
+        Write(section.data(), section.size() * sizeof(T));
+    }
+
+    void Close() {
+        out_.close();
+        if (!out_) {
+            throw std::runtime_error("Cannot write index file");
+        }
+    }
+
+private:
+    std::ofstream out_;
+};
+
+}  // namespace
+
+void SaveIndex(const SearchServer& search_server, const std::string& path) {
+    using Header = MappedSearchServer::Header;
+    using Posting = MappedSearchServer::Posting;
+    using TermFreq = MappedSearchServer::TermFreq;
+    using DocumentOrdinal = MappedSearchServer::DocumentOrdinal;
+
+    std::string stop_words;
+    for (const std::string& stop_word : search_server.stop_words_) {
+        if (!stop_words.empty()) {
+            stop_words += ' ';
+        }
+        stop_words += stop_word;
+    }
+
+    const TermDictionary& terms = search_server.terms_;
+    const size_t term_count = terms.GetTermCount();
+    size_t hash_table_size = 2;
+    while (hash_table_size < 2 * term_count) {
+        hash_table_size *= 2;
+    }
+    std::vector<uint32_t> term_slots(hash_table_size, MappedSearchServer::EMPTY_SLOT);
+    std::vector<uint64_t> term_offsets = {0};
+    std::string term_chars;
+    for (TermId term_id = 0; term_id < static_cast<TermId>(term_count); ++term_id) {
+        const std::string_view term = terms.GetTerm(term_id);
+        size_t slot = MappedSearchServer::HashTerm(term) & (hash_table_size - 1);
+        while (term_slots[slot] != MappedSearchServer::EMPTY_SLOT) {
+            slot = (slot + 1) & (hash_table_size - 1);
+        }
+        term_slots[slot] = static_cast<uint32_t>(term_id);
+        term_chars += term;
+        term_offsets.push_back(term_chars.size());
+    }
+
+    // Удалённые документы пропускаются, оставшиеся нумеруются подряд без смены порядка
+    const size_t ordinal_count = search_server.ordinal_to_document_id_.size();
+    std::vector<int32_t> new_ordinals(ordinal_count, -1);
+    std::vector<int32_t> document_ids;
+    std::vector<int32_t> ratings;
+    std::vector<int32_t> statuses;
+    std::vector<uint64_t> term_freq_offsets = {0};
+    std::vector<TermFreq> term_freqs;
+    for (size_t ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+        const int document_id = search_server.ordinal_to_document_id_[ordinal];
+        const auto it = search_server.document_id_to_ordinal_.find(document_id);
+        if (it == search_server.document_id_to_ordinal_.end() || it->second != static_cast<int>(ordinal)) {
+            continue;
+        }
+        new_ordinals[ordinal] = static_cast<int32_t>(document_ids.size());
+        document_ids.push_back(document_id);
+        ratings.push_back(search_server.ratings_[ordinal]);
+        statuses.push_back(static_cast<int32_t>(search_server.statuses_[ordinal]));
+        for (const auto[term_id, count] : search_server.ordinal_to_term_counts_[ordinal]) {
+            term_freqs.push_back({term_id, 0, search_server.GetTermFreq(static_cast<int>(ordinal), count)});
+        }
+        term_freq_offsets.push_back(term_freqs.size());
+    }
+
+    // Отсортированы по id для двоичного поиска
+    std::vector<DocumentOrdinal> document_ordinals;
+    for (const auto[document_id, ordinal] : search_server.document_id_to_ordinal_) {
+        document_ordinals.push_back({document_id, new_ordinals[ordinal]});
+    }
+    std::sort(document_ordinals.begin(), document_ordinals.end(), [](const DocumentOrdinal& lhs,
+                                                                     const DocumentOrdinal& rhs) {
+        return lhs.document_id < rhs.document_id;
+    });
+
+    std::vector<uint64_t> posting_offsets = {0};
+    std::vector<Posting> postings;
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        if (term_id < search_server.term_postings_.size()) {
+            search_server.term_postings_[term_id].ForEach([&](int ordinal, int count) {
+                postings.push_back({new_ordinals[ordinal], 0, search_server.GetTermFreq(ordinal, count)});
+            });
+        }
+        posting_offsets.push_back(postings.size());
+    }
+
+    Header header{};
+    std::memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic));
+    header.version = INDEX_FILE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.stop_words_size = stop_words.size();
+    header.hash_table_size = hash_table_size;
+    header.term_count = term_count;
+    header.term_chars_size = term_chars.size();
+    header.posting_count = postings.size();
+    header.document_count = document_ids.size();
+    header.term_freq_count = term_freqs.size();
+
+    IndexWriter writer(path);
+    writer.Write(&header, sizeof(header));
+    writer.Write(stop_words.data(), stop_words.size());
+    writer.Write(term_slots);
+    writer.Write(term_offsets);
+    writer.Write(term_chars.data(), term_chars.size());
+    writer.Write(posting_offsets);
+    writer.Write(postings);
+    writer.Write(document_ids);
+    writer.Write(ratings);
+    writer.Write(statuses);
+    writer.Write(document_ordinals);
+    writer.Write(term_freq_offsets);
+    writer.Write(term_freqs);
+    writer.Close();
+}
+
+MappedSearchServer::MappedFile::MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open index file " + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Index file " + path + " is empty");
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    // Отображение остаётся действительным и после закрытия дескриптора
+    close(fd);
+    if (data_ == MAP_FAILED) {
+        throw std::runtime_error("Cannot map index file " + path);
+    }
+}
+
+MappedSearchServer::MappedFile::~MappedFile() {
+    munmap(data_, size_);
+}
+
+const char* MappedSearchServer::MappedFile::GetData() const {
+    return static_cast<const char*>(data_);
+}
+
+size_t MappedSearchServer::MappedFile::GetSize() const {
+    return size_;
+}
+
+MappedSearchServer::MappedSearchServer(const std::string& path)
+        : file_(path), header_(CheckHeader(file_)), query_parser_(GetStopWords(header_)) {
+    size_t offset = sizeof(Header);
+    const auto take = [this, &offset](uint64_t count, size_t element_size) {
+        if (offset > file_.GetSize() || count > (file_.GetSize() - offset) / element_size) {
+            throw std::runtime_error("Index file is truncated");
+        }
+        const char* section = file_.GetData() + offset;
+        offset += AlignSize(count * element_size);
+        return section;
+    };
+    take(header_.stop_words_size, sizeof(char));
+    // Слов меньше ячеек таблицы, поэтому term_count + 1 не переполняется, а в таблице есть свободная ячейка
+    if ((header_.hash_table_size & (header_.hash_table_size - 1)) != 0 || header_.hash_table_size == 0
+        || header_.term_count >= header_.hash_table_size || header_.term_count > INT32_MAX
+        || header_.document_count > INT32_MAX) {
+        throw std::runtime_error("Index file is corrupted");
+    }
+    term_slots_ = reinterpret_cast<const uint32_t*>(take(header_.hash_table_size, sizeof(uint32_t)));
+    term_offsets_ = reinterpret_cast<const uint64_t*>(take(header_.term_count + 1, sizeof(uint64_t)));
+    term_chars_ = take(header_.term_chars_size, sizeof(char));
+    posting_offsets_ = reinterpret_cast<const uint64_t*>(take(header_.term_count + 1, sizeof(uint64_t)));
+    postings_ = reinterpret_cast<const Posting*>(take(header_.posting_count, sizeof(Posting)));
+    document_ids_ = reinterpret_cast<const int32_t*>(take(header_.document_count, sizeof(int32_t)));
+    ratings_ = reinterpret_cast<const int32_t*>(take(header_.document_count, sizeof(int32_t)));
+    statuses_ = reinterpret_cast<const int32_t*>(take(header_.document_count, sizeof(int32_t)));
+    document_ordinals_ = reinterpret_cast<const DocumentOrdinal*>(take(header_.document_count,
+                                                                       sizeof(DocumentOrdinal)));
+    term_freq_offsets_ = reinterpret_cast<const uint64_t*>(take(header_.document_count + 1, sizeof(uint64_t)));
+    term_freqs_ = reinterpret_cast<const TermFreq*>(take(header_.term_freq_count, sizeof(TermFreq)));
+    if (offset != file_.GetSize()) {
+        throw std::runtime_error("Index file is corrupted");
+    }
+}
+
+void MappedSearchServer::Validate() const {
+    const auto check = [](bool is_valid) {
+        if (!is_valid) {
+            throw std::runtime_error("Index file is corrupted");
+        }
+    };
+    // Границы секций начинаются с нуля, не убывают и заканчиваются размером секции
+    const auto check_offsets = [&check](const uint64_t* offsets, uint64_t count, uint64_t section_size) {
+        check(offsets[0] == 0 && offsets[count] == section_size);
+        for (uint64_t i = 0; i < count; ++i) {
+            check(offsets[i] <= offsets[i + 1]);
+        }
+    };
+    const auto term_count = static_cast<TermId>(header_.term_count);
+    const auto document_count = static_cast<int>(header_.document_count);
+    check_offsets(term_offsets_, header_.term_count, header_.term_chars_size);
+    check_offsets(posting_offsets_, header_.term_count, header_.posting_count);
+    check_offsets(term_freq_offsets_, header_.document_count, header_.term_freq_count);
+
+    // Каждое слово лежит в таблице ровно один раз, а свободная ячейка останавливает поиск
+    std::vector<bool> is_term_slotted(header_.term_count);
+    for (uint64_t slot = 0; slot < header_.hash_table_size; ++slot) {
+        if (term_slots_[slot] == EMPTY_SLOT) {
+            continue;
+        }
+        check(term_slots_[slot] < header_.term_count && !is_term_slotted[term_slots_[slot]]);
+        is_term_slotted[term_slots_[slot]] = true;
+    }
+    // Слов меньше ячеек, поэтому, когда все слова на месте, свободная ячейка тоже есть
+    check(std::find(is_term_slotted.begin(), is_term_slotted.end(), false) == is_term_slotted.end());
+
+    // Постинги слова и слова документа упорядочены по возрастанию, как их записал SaveIndex
+    for (TermId term_id = 0; term_id < term_count; ++term_id) {
+        for (uint64_t i = posting_offsets_[term_id]; i < posting_offsets_[term_id + 1]; ++i) {
+            check(postings_[i].ordinal >= 0 && postings_[i].ordinal < document_count
+                  && (i == posting_offsets_[term_id] || postings_[i - 1].ordinal < postings_[i].ordinal));
+        }
+    }
+    for (int ordinal = 0; ordinal < document_count; ++ordinal) {
+        check(statuses_[ordinal] >= static_cast<int32_t>(DocumentStatus::ACTUAL)
+              && statuses_[ordinal] <= static_cast<int32_t>(DocumentStatus::REMOVED));
+        for (uint64_t i = term_freq_offsets_[ordinal]; i < term_freq_offsets_[ordinal + 1]; ++i) {
+            check(term_freqs_[i].term_id >= 0 && term_freqs_[i].term_id < term_count
+                  && (i == term_freq_offsets_[ordinal] || term_freqs_[i - 1].term_id < term_freqs_[i].term_id));
+        }
+    }
+    // Пары (id, номер) идут по возрастанию id и согласованы со столбцом id
+    for (int i = 0; i < document_count; ++i) {
+        const DocumentOrdinal& entry = document_ordinals_[i];
+        check(entry.ordinal >= 0 && entry.ordinal < document_count
+              && document_ids_[entry.ordinal] == entry.document_id
+              && (i == 0 || document_ordinals_[i - 1].document_id < entry.document_id));
+    }
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                           size_t top_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, top_count);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(const std::execution::sequenced_policy&,
+                                                           std::string_view raw_query, DocumentStatus status,
+                                                           size_t top_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, [status]([[maybe_unused]] int document_id,
+                                                                     DocumentStatus document_status,
+                                                                     [[maybe_unused]] int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(const std::execution::parallel_policy&,
+                                                           std::string_view raw_query, DocumentStatus status,
+                                                           size_t top_count) const {
+    return FindTopDocuments(std::execution::par, raw_query, [status]([[maybe_unused]] int document_id,
+                                                                     DocumentStatus document_status,
+                                                                     [[maybe_unused]] int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+int MappedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(header_.document_count);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+MappedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    const auto query = query_parser_.ParseQuery(raw_query);
+    const int ordinal = FindOrdinal(document_id);
+    if (ordinal < 0) {
+        throw std::out_of_range("Document is not found");
+    }
+    const auto status = static_cast<DocumentStatus>(statuses_[ordinal]);
+    for (std::string_view word : query.minus_words) {
+        const TermId term_id = FindTerm(word);
+        if (term_id != NO_TERM && HasTerm(ordinal, term_id)) {
+            return {std::vector<std::string_view>(), status};
+        }
+    }
+    std::vector<std::string_view> matched_words;
+    for (std::string_view word : query.plus_words) {
+        const TermId term_id = FindTerm(word);
+        if (term_id != NO_TERM && HasTerm(ordinal, term_id)) {
+            matched_words.push_back(GetTerm(term_id));
+        }
+    }
+    return {matched_words, status};
+}
+
+uint64_t MappedSearchServer::HashTerm(std::string_view term) {
+    // FNV-1a: хеш записан в файл, поэтому не должен зависеть от реализации std::hash
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : term) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+const MappedSearchServer::Header& MappedSearchServer::CheckHeader(const MappedFile& file) {
+    if (file.GetSize() < sizeof(Header)) {
+        throw std::runtime_error("Index file is truncated");
+    }
+    const Header& header = *reinterpret_cast<const Header*>(file.GetData());
+    if (std::memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("File is not a search index");
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Index file has a different byte order");
+    }
+    if (header.version != INDEX_FILE_VERSION) {
+        throw std::runtime_error("Unsupported index file version " + std::to_string(header.version));
+    }
+    if (header.stop_words_size > file.GetSize() - sizeof(Header)) {
+        throw std::runtime_error("Index file is truncated");
+    }
+    return header;
+}
+
+std::string_view MappedSearchServer::GetStopWords(const Header& header) {
+    const std::string_view stop_words(reinterpret_cast<const char*>(&header) + sizeof(Header),
+                                      header.stop_words_size);
+    // Иначе конструктор разбора запросов бросил бы invalid_argument, а не ошибку файла
+    if (!SearchServer::IsValidWord(stop_words)) {
+        throw std::runtime_error("Index file is corrupted");
+    }
+    return stop_words;
+}
+
+TermId MappedSearchServer::FindTerm(std::string_view term) const {
+    const uint64_t mask = header_.hash_table_size - 1;
+    for (uint64_t slot = HashTerm(term) & mask; term_slots_[slot] != EMPTY_SLOT; slot = (slot + 1) & mask) {
+        const auto term_id = static_cast<TermId>(term_slots_[slot]);
+        if (GetTerm(term_id) == term) {
+            return term_id;
+        }
+    }
+    return NO_TERM;
+}
+
+std::string_view MappedSearchServer::GetTerm(TermId term_id) const {
+    return {term_chars_ + term_offsets_[term_id], term_offsets_[term_id + 1] - term_offsets_[term_id]};
+}
+
+int MappedSearchServer::FindOrdinal(int document_id) const {
+    const DocumentOrdinal* end = document_ordinals_ + header_.document_count;
+    const DocumentOrdinal* it = std::lower_bound(document_ordinals_, end, document_id,
+                                                 [](const DocumentOrdinal& entry, int value) {
+                                                     return entry.document_id < value;
+                                                 });
+    return it != end && it->document_id == document_id ? it->ordinal : -1;
+}
+
+bool MappedSearchServer::HasTerm(int ordinal, TermId term_id) const {
+    return std::binary_search(term_freqs_ + term_freq_offsets_[ordinal], term_freqs_ + term_freq_offsets_[ordinal + 1],
+                              TermFreq{term_id, 0, 0.0},
+                              [](const TermFreq& lhs, const TermFreq& rhs) { return lhs.term_id < rhs.term_id; });
+}
+
+double MappedSearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const {
+    return log(double(GetDocumentCount()) / (posting_offsets_[term_id + 1] - posting_offsets_[term_id]));
+}
+
+DocumentBitmap MappedSearchServer::FindExcludedDocuments(const SearchServer::Query& query) const {
+    DocumentBitmap excluded_documents;
+    for (std::string_view word : query.minus_words) {
+        const TermId term_id = FindTerm(word);
+        if (term_id == NO_TERM || posting_offsets_[term_id] == posting_offsets_[term_id + 1]) {
+            continue;
+        }
+        if (excluded_documents.IsEmpty()) {
+            excluded_documents = DocumentBitmap(header_.document_count);
+        }
+        for (uint64_t i = posting_offsets_[term_id]; i < posting_offsets_[term_id + 1]; ++i) {
+            excluded_documents.Insert(postings_[i].ordinal);
+        }
+    }
+    return excluded_documents;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "search_server.h"
+
+constexpr uint32_t INDEX_FILE_VERSION = 1;
+
+// Сохраняет индекс в бинарный файл, который открывает MappedSearchServer.
+// Удалённые документы в файл не попадают, оставшиеся получают номера подряд в прежнем порядке
+void SaveIndex(const SearchServer& search_server, const std::string& path);
+
+// Сервер только для чтения над файлом SaveIndex. Файл отображается в память через mmap,
+// и запросы читают словарь, постинги и метаданные прямо из отображения, ничего не разворачивая:
+// открытие проверяет только заголовок и границы секций, а страницы индекса подгружаются по мере обращения.
+// Релевантность совпадает с SearchServer, индекс которого был сохранён
+class MappedSearchServer {
+public:
+    explicit MappedSearchServer(const std::string& path);
+
+    // Проверяет номера и границы во всех секциях, кроме частот слов и рейтингов, которые могут быть любыми,
+    // и бросает runtime_error, если файл повреждён. Читает файл целиком, поэтому вызывается явно:
+    // без проверки запросы к повреждённому файлу могут читать за пределами отображения
+    void Validate() const;
+
+    MappedSearchServer(const MappedSearchServer&) = delete;
+    MappedSearchServer& operator=(const MappedSearchServer&) = delete;
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_count);
+    }
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        const auto query = query_parser_.ParseQuery(raw_query);
+        auto matched_documents = FindAllDocuments(std::execution::seq, query, document_predicate);
+        SelectTopDocuments(std::execution::seq, matched_documents, top_count);
+        return matched_documents;
+    }
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        const auto query = query_parser_.ParseQuery(raw_query);
+        auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
+        SelectTopDocuments(std::execution::par, matched_documents, top_count);
+        return matched_documents;
+    }
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+    // Найденные слова ссылаются на отображённый файл и действительны, пока жив сервер
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+private:
+    friend void SaveIndex(const SearchServer& search_server, const std::string& path);
+
+    // Файл состоит из заголовка и секций, каждая из которых выровнена на 8 байт:
+    // стоп-слова через пробел, хеш-таблица слов, границы слов и их символы, границы списков постингов
+    // и сами постинги, столбцы id, рейтингов и статусов документов, пары (id, номер) по возрастанию id,
+    // границы прямого индекса и его элементы. Числа записаны в порядке байт машины, сохранившей файл
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t stop_words_size;
+        uint64_t hash_table_size;
+        uint64_t term_count;
+        uint64_t term_chars_size;
+        uint64_t posting_count;
+        uint64_t document_count;
+        uint64_t term_freq_count;
+    };
+
+    struct Posting {
+        int32_t ordinal;
+        int32_t padding;
+        double term_freq;
+    };
+
+    struct TermFreq {
+        int32_t term_id;
+        int32_t padding;
+        double term_freq;
+    };
+
+    struct DocumentOrdinal {
+        int32_t document_id;
+        int32_t ordinal;
+    };
+
+    // Отображение файла в память, снимается в деструкторе
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& path);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile();
+
+        const char* GetData() const;
+
+        size_t GetSize() const;
+
+    private:
+        void* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    const MappedFile file_;
+    const Header& header_;
+
+    // Пустой сервер со стоп-словами файла разбирает запросы
+    SearchServer query_parser_;
+
+    // Хеш-таблица с открытой адресацией: номера слов, EMPTY_SLOT в свободных ячейках
+    const uint32_t* term_slots_ = nullptr;
+    const uint64_t* term_offsets_ = nullptr;
+    const char* term_chars_ = nullptr;
+    const uint64_t* posting_offsets_ = nullptr;
+    const Posting* postings_ = nullptr;
+    const int32_t* document_ids_ = nullptr;
+    const int32_t* ratings_ = nullptr;
+    const int32_t* statuses_ = nullptr;
+    const DocumentOrdinal* document_ordinals_ = nullptr;
+    const uint64_t* term_freq_offsets_ = nullptr;
+    const TermFreq* term_freqs_ = nullptr;
+
+    static uint64_t HashTerm(std::string_view term);
+
+    static const Header& CheckHeader(const MappedFile& file);
+
+    static std::string_view GetStopWords(const Header& header);
+
+    TermId FindTerm(std::string_view term) const;
+
+    std::string_view GetTerm(TermId term_id) const;
+
+    int FindOrdinal(int document_id) const;
+
+    bool HasTerm(int ordinal, TermId term_id) const;
+
+    double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+    DocumentBitmap FindExcludedDocuments(const SearchServer::Query& query) const;
+
+    template<typename DocumentPredicate>
+    bool IsAccepted(DocumentPredicate& document_predicate, int ordinal) const {
+        return document_predicate(document_ids_[ordinal], static_cast<DocumentStatus>(statuses_[ordinal]),
+                                  ratings_[ordinal]);
+    }
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const SearchServer::Query& query,
+                                           DocumentPredicate document_predicate) const {
+        const DocumentBitmap excluded_documents = FindExcludedDocuments(query);
+        std::map<int, double> document_to_relevance;
+        for (std::string_view word : query.plus_words) {
+            const TermId term_id = FindTerm(word);
+            if (term_id == NO_TERM) {
+                continue;
+            }
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+            for (uint64_t i = posting_offsets_[term_id]; i < posting_offsets_[term_id + 1]; ++i) {
+                const Posting& posting = postings_[i];
+                if (!excluded_documents.Contains(posting.ordinal) && IsAccepted(document_predicate, posting.ordinal)) {
+                    document_to_relevance[posting.ordinal] += posting.term_freq * inverse_document_freq;
+                }
+            }
+        }
+        std::vector<Document> matched_documents;
+        for (const auto[ordinal, relevance] : document_to_relevance) {
+            matched_documents.emplace_back(document_ids_[ordinal], relevance, ratings_[ordinal]);
+        }
+        return matched_documents;
+    }
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const SearchServer::Query& query,
+                                           DocumentPredicate document_predicate) const {
+        // Отрезки номеров обрабатываются параллельно, как в SearchServer, а слова внутри отрезка — по очереди
+        const DocumentBitmap excluded_documents = FindExcludedDocuments(query);
+        std::vector<std::pair<TermId, double>> query_terms;
+        for (std::string_view word : query.plus_words) {
+            const TermId term_id = FindTerm(word);
+            if (term_id != NO_TERM) {
+                query_terms.emplace_back(term_id, ComputeWordInverseDocumentFreq(term_id));
+            }
+        }
+        const auto by_ordinal = [](const Posting& posting, int ordinal) {
+            return posting.ordinal < ordinal;
+        };
+        return AccumulateRelevanceByRanges(
+                GetDocumentCount(),
+                [&](RelevanceRange& range) {
+                    for (const auto&[term_id, inverse_document_freq] : query_terms) {
+                        const Posting* const postings_end = postings_ + posting_offsets_[term_id + 1];
+                        for (const Posting* posting = std::lower_bound(postings_ + posting_offsets_[term_id],
+                                                                       postings_end, range.GetBegin(), by_ordinal);
+                             posting != postings_end && posting->ordinal < range.GetEnd(); ++posting) {
+                            if (!excluded_documents.Contains(posting->ordinal)
+                                && IsAccepted(document_predicate, posting->ordinal)) {
+                                range.Add(posting->ordinal, posting->term_freq * inverse_document_freq);
+                            }
+                        }
+                    }
+                },
+                [this](int ordinal, double relevance) {
+                    return Document(document_ids_[ordinal], relevance, ratings_[ordinal]);
+                });
+    }
+};
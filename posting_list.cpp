@@ -0,0 +1,168 @@
+#include "posting_list.h"
+
+#include <iterator>
+#include <utility>
+
+void PostingList::PushBack(int ordinal, int count) {
+    if (blocks_.empty() || blocks_.back().posting_count == BLOCK_POSTING_COUNT) {
+        blocks_.push_back({ordinal, ordinal, 0, 0, bytes_.size()});
+    }
+    Block& block = blocks_.back();
+    const size_t previous_size = bytes_.size();
+    WriteVarint(bytes_, static_cast<uint32_t>(ordinal - block.last_ordinal));
+    WriteVarint(bytes_, static_cast<uint32_t>(count));
+    block.byte_count += static_cast<int>(bytes_.size() - previous_size);
+    used_byte_count_ += bytes_.size() - previous_size;
+    block.last_ordinal = ordinal;
+    ++block.posting_count;
+    ++size_;
+}
+
+void PostingList::Erase(int ordinal) {
+    auto block_it = std::upper_bound(blocks_.begin(), blocks_.end(), ordinal,
+                                     [](int value, const Block& block) { return value < block.first_ordinal; });
+    if (block_it == blocks_.begin() || std::prev(block_it)->last_ordinal < ordinal) {
+        return;
+    }
+    --block_it;
+
+    std::vector<std::pair<int, int>> postings;
+    DecodeBlock(*block_it, [&postings](int posting_ordinal, int count) {
+        postings.emplace_back(posting_ordinal, count);
+    });
+    const auto posting_it = std::find_if(postings.begin(), postings.end(), [ordinal](const auto& posting) {
+        return posting.first == ordinal;
+    });
+    if (posting_it == postings.end()) {
+        return;
+    }
+    postings.erase(posting_it);
+    --size_;
+    // Опустевший список отдаёт память
+    if (size_ == 0) {
+        bytes_ = {};
+        blocks_ = {};
+        used_byte_count_ = 0;
+        return;
+    }
+
+    const bool is_last_block = std::next(block_it) == blocks_.end();
+    used_byte_count_ -= block_it->byte_count;
+    if (postings.empty()) {
+        // Заголовок удаляется один раз на все постинги блока
+        blocks_.erase(block_it);
+    } else {
+        // Перекодируется только блок с удалённым постингом, остальные блоки и смещения не трогаются.
+        // Слитая разность не длиннее двух исходных, поэтому блок помещается на старое место
+        std::vector<uint8_t> block_bytes;
+        int previous_ordinal = postings.front().first;
+        for (const auto&[posting_ordinal, count] : postings) {
+            WriteVarint(block_bytes, static_cast<uint32_t>(posting_ordinal - previous_ordinal));
+            WriteVarint(block_bytes, static_cast<uint32_t>(count));
+            previous_ordinal = posting_ordinal;
+        }
+        std::copy(block_bytes.begin(), block_bytes.end(), bytes_.begin() + block_it->offset);
+        block_it->first_ordinal = postings.front().first;
+        block_it->last_ordinal = postings.back().first;
+        block_it->posting_count = static_cast<int>(postings.size());
+        block_it->byte_count = static_cast<int>(block_bytes.size());
+        used_byte_count_ += block_bytes.size();
+    }
+    if (is_last_block) {
+        bytes_.resize(blocks_.back().offset + blocks_.back().byte_count);
+    }
+    CompactBytesIfNeeded();
+}
+
+void PostingList::Erase(const std::vector<int>& ordinals) {
+    // Список перекодируется целиком: это дешевле, чем сдвигать хвост после каждого удаления
+    PostingList postings;
+    auto ordinal_it = ordinals.begin();
+    ForEach([&postings, &ordinals, &ordinal_it](int ordinal, int count) {
+        ordinal_it = std::lower_bound(ordinal_it, ordinals.end(), ordinal);
+        if (ordinal_it == ordinals.end() || *ordinal_it != ordinal) {
+            postings.PushBack(ordinal, count);
+        }
+    });
+    *this = std::move(postings);
+}
+
+void PostingList::CompactBytesIfNeeded() {
+    // Переписывается меньше байтов, чем освободилось с прошлого сжатия, поэтому в среднем удаление
+    // по-прежнему стоит одного блока
+    if (bytes_.size() - used_byte_count_ <= used_byte_count_) {
+        return;
+    }
+    std::vector<uint8_t> bytes;
+    bytes.reserve(used_byte_count_);
+    for (Block& block : blocks_) {
+        const auto block_begin = bytes_.begin() + block.offset;
+        block.offset = bytes.size();
+        bytes.insert(bytes.end(), block_begin, block_begin + block.byte_count);
+    }
+    bytes_ = std::move(bytes);
+}
+
+size_t PostingList::GetSize() const {
+    return size_;
+}
+
+bool PostingList::IsEmpty() const {
+    return size_ == 0;
+}
+
+void PostingList::WriteVarint(std::vector<uint8_t>& bytes, uint32_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings) : postings_(&postings) {
+    Next();
+}
+
+bool PostingList::Cursor::IsEnd() const {
+    return is_end_;
+}
+
+int PostingList::Cursor::GetOrdinal() const {
+    return ordinal_;
+}
+
+int PostingList::Cursor::GetCount() const {
+    return count_;
+}
+
+void PostingList::Cursor::Next() {
+    if (remaining_in_block_ == 0) {
+        if (next_block_index_ == postings_->blocks_.size()) {
+            is_end_ = true;
+            return;
+        }
+        const Block& block = postings_->blocks_[next_block_index_++];
+        data_ = postings_->bytes_.data() + block.offset;
+        ordinal_ = block.first_ordinal;
+        remaining_in_block_ = block.posting_count;
+    }
+    ordinal_ += static_cast<int>(ReadVarint(data_));
+    count_ = static_cast<int>(ReadVarint(data_));
+    --remaining_in_block_;
+}
+
+void PostingList::Cursor::SkipTo(int ordinal) {
+    if (is_end_ || ordinal_ >= ordinal) {
+        return;
+    }
+    const auto& blocks = postings_->blocks_;
+    if (blocks[next_block_index_ - 1].last_ordinal < ordinal) {
+        while (next_block_index_ < blocks.size() && blocks[next_block_index_].last_ordinal < ordinal) {
+            ++next_block_index_;
+        }
+        remaining_in_block_ = 0;
+    }
+    do {
+        Next();
+    } while (!is_end_ && ordinal_ < ordinal);
+}
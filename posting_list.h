@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <vector>
+
+// Список постингов слова, сжатый блоками по BLOCK_POSTING_COUNT постингов. Внутри блока
+// номер документа хранится разностью с предыдущим, а разности и числа вхождений — в varint
+// (7 бит на байт). Заголовок блока помнит его первый и последний номер и смещение, поэтому
+// блоки декодируются независимо: их можно обходить параллельно и перекодировать по одному.
+// Блок после удаления перекодируется на своём месте, а освободившиеся байты остаются между блоками,
+// пока их не станет больше занятых: тогда блоки переписываются подряд
+class PostingList {
+public:
+    // ordinal должен быть больше всех номеров в списке
+    void PushBack(int ordinal, int count);
+
+    void Erase(int ordinal);
+
+    // Удаляет несколько постингов за один проход, ordinals отсортированы по возрастанию
+    void Erase(const std::vector<int>& ordinals);
+
+    size_t GetSize() const;
+
+    bool IsEmpty() const;
+
+    // Последовательный обход постингов по возрастанию номера
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool IsEnd() const;
+
+        int GetOrdinal() const;
+
+        int GetCount() const;
+
+        void Next();
+
+        // Переходит к первому постингу с номером не меньше ordinal. Блоки, все номера которых
+        // меньше ordinal, пропускаются по заголовкам без декодирования
+        void SkipTo(int ordinal);
+
+    private:
+        const PostingList* postings_;
+        size_t next_block_index_ = 0;
+        int remaining_in_block_ = 0;
+        const uint8_t* data_ = nullptr;
+        int ordinal_ = 0;
+        int count_ = 0;
+        bool is_end_ = false;
+    };
+
+    // function(ordinal, count) вызывается для постингов по возрастанию номера
+    template<typename Function>
+    void ForEach(Function function) const {
+        for (const Block& block : blocks_) {
+            DecodeBlock(block, function);
+        }
+    }
+
+    // function(ordinal, count) вызывается для постингов с номерами из [begin_ordinal, end_ordinal)
+    // по возрастанию номера. Первый нужный блок находится двоичным поиском по заголовкам
+    template<typename Function>
+    void ForEachInRange(int begin_ordinal, int end_ordinal, Function function) const {
+        auto block = std::partition_point(blocks_.begin(), blocks_.end(), [begin_ordinal](const Block& block) {
+            return block.last_ordinal < begin_ordinal;
+        });
+        for (; block != blocks_.end() && block->first_ordinal < end_ordinal; ++block) {
+            DecodeBlock(*block, [begin_ordinal, end_ordinal, &function](int ordinal, int count) {
+                if (ordinal >= begin_ordinal && ordinal < end_ordinal) {
+                    function(ordinal, count);
+                }
+            });
+        }
+    }
+
+    // Блоки обходятся параллельно, номера в разных вызовах function различны
+    template<typename Function>
+    void ForEach(const std::execution::parallel_policy&, Function function) const {
+        std::for_each(std::execution::par, blocks_.begin(), blocks_.end(), [this, &function](const Block& block) {
+            DecodeBlock(block, function);
+        });
+    }
+
+private:
+    static constexpr int BLOCK_POSTING_COUNT = 128;
+
+    struct Block {
+        int first_ordinal;
+        int last_ordinal;
+        int posting_count;
+        // Занимает место выравнивания, размер заголовка не растёт
+        int byte_count;
+        size_t offset;
+    };
+
+    // Байты последнего блока всегда идут до конца bytes_, поэтому PushBack дописывает их подряд
+    std::vector<uint8_t> bytes_;
+    std::vector<Block> blocks_;
+    size_t size_ = 0;
+    // Сумма byte_count всех блоков, остальные байты bytes_ свободны
+    size_t used_byte_count_ = 0;
+
+    void CompactBytesIfNeeded();
+
+    static void WriteVarint(std::vector<uint8_t>& bytes, uint32_t value);
+
+    static uint32_t ReadVarint(const uint8_t*& data) {
+        uint32_t value = *data & 0x7F;
+        for (int shift = 7; *data++ & 0x80; shift += 7) {
+            value |= static_cast<uint32_t>(*data & 0x7F) << shift;
+        }
+        return value;
+    }
+
+    template<typename Function>
+    void DecodeBlock(const Block& block, Function&& function) const {
+        const uint8_t* data = bytes_.data() + block.offset;
+        int ordinal = block.first_ordinal;
+        for (int i = 0; i < block.posting_count; ++i) {
+            ordinal += static_cast<int>(ReadVarint(data));
+            function(ordinal, static_cast<int>(ReadVarint(data)));
+        }
+    }
+};
@@ -1,24 +1,477 @@
 #include "process_queries.h"
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
+#include "work_stealing_pool.h"
 
-std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
-    std::vector<std::vector<Document>> result(queries.size());
-    std::transform(std::execution::par, queries.cbegin(), queries.cend(),result.begin(),
-                   [&search_server](std::string query) { return search_server.FindTopDocuments(query);});
-    return result;
+// Выполняет пакет запросов FindTopDocuments(query) со статусом ACTUAL. Постинги плюс-слов
+// раскодируются один раз для всех запросов пакета, вместе с готовыми вкладами в релевантность;
+// длинные списки и списки сверх бюджета пакета обходятся в сжатом виде. Запросы оцениваются
+// в общем пуле с перехватом задач документ за документом с отсечением (MaxScore).
+// Вклады складываются в алфавитном порядке слов запроса, как в FindAllDocuments, поэтому
+// релевантность совпадает с одиночным поиском до бита
+class BatchQueryExecutor {
+public:
+    explicit BatchQueryExecutor(const SearchServer& search_server)
+            : search_server_(search_server), workers_(GetWorkers()), pool_(workers_.pool) {
+    }
+
+    // Выполняет запросы queries[begin, end)
+    std::vector<std::vector<Document>> FindTopDocuments(const std::vector<std::string>& queries, size_t begin,
+                                                        size_t end) {
+        std::vector<ParsedQuery> parsed_queries(end - begin);
+        pool_.ForEachIndex(parsed_queries.size(), [this, &queries, &parsed_queries, begin](size_t, size_t index) {
+            ParseQuery(queries[begin + index], parsed_queries[index]);
+        });
+        // Ошибка сообщается та же, что при поиске по запросам по очереди
+        for (const ParsedQuery& parsed_query : parsed_queries) {
+            if (parsed_query.error) {
+                std::rethrow_exception(parsed_query.error);
+            }
+        }
+
+        DecodeTerms(parsed_queries);
+
+        std::vector<std::vector<Document>> results(parsed_queries.size());
+        pool_.ForEachIndex(parsed_queries.size(), [this, &parsed_queries, &results](size_t worker_index,
+                                                                                    size_t index) {
+            results[index] = ScoreQuery(parsed_queries[index], workers_.buffers[worker_index]);
+        });
+        return results;
+    }
+
+private:
+    static constexpr size_t NO_SLOT = SIZE_MAX;
+    // Раскодированный постинг занимает 12 байт против 2–4 в сжатом списке, поэтому раскодируются
+    // только не слишком длинные списки и не больше бюджета на пакет
+    static constexpr size_t MAX_DECODED_TERM_POSTINGS = 1 << 16;
+    static constexpr size_t MAX_DECODED_BATCH_POSTINGS = 1 << 20;
+
+    // Номера слов запроса, после DecodeTerms — номера их раскодированных постингов.
+    // Плюс-слова идут в алфавитном порядке, слова без постингов отброшены
+    struct ParsedQuery {
+        std::vector<size_t> plus_terms;
+        std::vector<size_t> minus_terms;
+        std::exception_ptr error;
+    };
+
+    struct DecodedTerm {
+        explicit DecodedTerm(TermId term_id) : term_id(term_id) {
+        }
+
+        TermId term_id;
+        bool is_plus = false;
+        bool is_decoded = false;
+        double inverse_document_freq = 0.0;
+        // Граница вклада: у раскодированных слов точная, у остальных — по наибольшей частоте слова
+        double max_score = 0.0;
+        // Только у раскодированных слов. Вклад в релевантность — частота, умноженная на IDF
+        std::vector<int> ordinals;
+        std::vector<double> scores;
+    };
+
+    // Раскодированные постинги обходятся по индексу, остальные — курсором сжатого списка
+    struct TermCursor {
+        const DecodedTerm* term;
+        size_t position;
+        PostingList::Cursor postings;
+
+        bool IsEnd() const {
+            return term->is_decoded ? position == term->ordinals.size() : postings.IsEnd();
+        }
+
+        int GetOrdinal() const {
+            return term->is_decoded ? term->ordinals[position] : postings.GetOrdinal();
+        }
+
+        double GetScore(const SearchServer& search_server) const {
+            if (term->is_decoded) {
+                return term->scores[position];
+            }
+            return search_server.GetTermFreq(postings.GetOrdinal(), postings.GetCount()) * term->inverse_document_freq;
+        }
+
+        void Next() {
+            if (term->is_decoded) {
+                ++position;
+            } else {
+                postings.Next();
+            }
+        }
+
+        void SkipTo(int ordinal) {
+            if (term->is_decoded) {
+                position = std::lower_bound(term->ordinals.begin() + position, term->ordinals.end(), ordinal)
+                           - term->ordinals.begin();
+            } else {
+                postings.SkipTo(ordinal);
+            }
+        }
+    };
+
+    // Отметки сравниваются с номером текущего запроса потока, поэтому массив не очищается между
+    // запросами. Отметки других серверов и пакетов меньше текущей, поэтому массив только растёт
+    struct WorkerBuffers {
+        std::vector<uint32_t> excluded_marks;
+        uint32_t mark = 0;
+        std::vector<TermCursor> cursors;
+        std::vector<TermCursor*> cursors_by_max_score;
+    };
+
+    // Буферы живут между пакетами, чтобы массив отметок выделялся и обнулялся один раз, а не на
+    // каждый вызов. Пул выполняет один ForEachIndex за раз, и одновременные задачи получают разные
+    // worker_index, поэтому буфер потока пула занят одной задачей.
+    // Пул и буферы общие для всего процесса: этапы одновременных вызовов, в том числе фонового
+    // потока ProcessQueriesJoined, выполняются на пуле по очереди
+    struct Workers {
+        Workers() : buffers(pool.GetThreadCount()) {
+        }
+
+        WorkStealingPool pool;
+        std::vector<WorkerBuffers> buffers;
+    };
+
+    const SearchServer& search_server_;
+    Workers& workers_;
+    WorkStealingPool& pool_;
+    std::vector<DecodedTerm> decoded_terms_;
+
+    static Workers& GetWorkers() {
+        static Workers workers;
+        return workers;
+    }
+
+    void ParseQuery(const std::string& raw_query, ParsedQuery& parsed_query) const {
+        try {
+            const auto query = search_server_.ParseQuery(raw_query);
+            const auto add_terms = [this](const SearchServer::QueryWords& words, std::vector<size_t>& terms) {
+                for (std::string_view word : words) {
+                    const TermId term_id = search_server_.terms_.Find(word);
+                    if (term_id != NO_TERM && !search_server_.term_postings_[term_id].IsEmpty()) {
+                        terms.push_back(term_id);
+                    }
+                }
+            };
+            add_terms(query.plus_words, parsed_query.plus_terms);
+            add_terms(query.minus_words, parsed_query.minus_terms);
+        } catch (...) {
+            parsed_query.error = std::current_exception();
+        }
+    }
+
+    const PostingList& GetPostings(const DecodedTerm& term) const {
+        return search_server_.term_postings_[term.term_id];
+    }
+
+    void DecodeTerms(std::vector<ParsedQuery>& parsed_queries) {
+        std::unordered_map<TermId, size_t> term_slots;
+        for (ParsedQuery& parsed_query : parsed_queries) {
+            for (auto* terms : {&parsed_query.plus_terms, &parsed_query.minus_terms}) {
+                for (size_t& term : *terms) {
+                    const auto [slot_it, is_new] = term_slots.emplace(static_cast<TermId>(term),
+                                                                      decoded_terms_.size());
+                    if (is_new) {
+                        decoded_terms_.emplace_back(static_cast<TermId>(term));
+                    }
+                    decoded_terms_[slot_it->second].is_plus |= terms == &parsed_query.plus_terms;
+                    term = slot_it->second;
+                }
+            }
+        }
+        // Минус-словам нужны только номера документов, их списки обходятся в сжатом виде
+        size_t decoded_posting_count = 0;
+        for (DecodedTerm& decoded_term : decoded_terms_) {
+            const size_t posting_count = GetPostings(decoded_term).GetSize();
+            decoded_term.is_decoded = decoded_term.is_plus && posting_count <= MAX_DECODED_TERM_POSTINGS
+                                      && decoded_posting_count + posting_count <= MAX_DECODED_BATCH_POSTINGS;
+            if (decoded_term.is_decoded) {
+                decoded_posting_count += posting_count;
+            }
+        }
+        pool_.ForEachIndex(decoded_terms_.size(), [this](size_t, size_t slot) {
+            DecodedTerm& decoded_term = decoded_terms_[slot];
+            if (!decoded_term.is_plus) {
+                return;
+            }
+            const PostingList& postings = GetPostings(decoded_term);
+            const double inverse_document_freq = search_server_.ComputeWordInverseDocumentFreq(decoded_term.term_id);
+            decoded_term.inverse_document_freq = inverse_document_freq;
+            if (!decoded_term.is_decoded) {
+                decoded_term.max_score = search_server_.max_term_freqs_[decoded_term.term_id] * inverse_document_freq;
+                return;
+            }
+            decoded_term.ordinals.reserve(postings.GetSize());
+            decoded_term.scores.reserve(postings.GetSize());
+            postings.ForEach([this, &decoded_term, inverse_document_freq](int ordinal, int count) {
+                decoded_term.ordinals.push_back(ordinal);
+                decoded_term.scores.push_back(search_server_.GetTermFreq(ordinal, count) * inverse_document_freq);
+            });
+            decoded_term.max_score = *std::max_element(decoded_term.scores.begin(), decoded_term.scores.end());
+        });
+    }
+
+    std::vector<Document> ScoreQuery(const ParsedQuery& parsed_query, WorkerBuffers& buffers) const {
+        const uint32_t mark = MarkExcludedDocuments(parsed_query, buffers);
+        std::vector<Document> documents = CollectCandidates(parsed_query, buffers, mark);
+        MEASURE_STAGE(TOP_K);
+        SelectTopDocuments(std::execution::seq, documents, MAX_RESULT_DOCUMENT_COUNT);
+        return documents;
+    }
+
+    // Отмечает документы с минус-словами запроса и возвращает отметку запроса
+    uint32_t MarkExcludedDocuments(const ParsedQuery& parsed_query, WorkerBuffers& buffers) const {
+        MEASURE_STAGE(MINUS_EXCLUSION);
+        const size_t ordinal_count = search_server_.ordinal_to_document_id_.size();
+        if (buffers.excluded_marks.size() < ordinal_count) {
+            buffers.excluded_marks.resize(ordinal_count, 0);
+        }
+        if (++buffers.mark == 0) {
+            std::fill(buffers.excluded_marks.begin(), buffers.excluded_marks.end(), 0);
+            buffers.mark = 1;
+        }
+        const uint32_t mark = buffers.mark;
+        for (const size_t slot : parsed_query.minus_terms) {
+            GetPostings(decoded_terms_[slot]).ForEach([&buffers, mark](int ordinal, int) {
+                buffers.excluded_marks[ordinal] = mark;
+            });
+        }
+        return mark;
+    }
+
+    // Документы, которые могут войти в ответ, по возрастанию номера
+    std::vector<Document> CollectCandidates(const ParsedQuery& parsed_query, WorkerBuffers& buffers,
+                                            uint32_t mark) const {
+        MEASURE_STAGE(POSTING_TRAVERSAL);
+        // Отсечение то же, что в SearchServer::FindTopDocumentsPruned, но по раскодированным постингам:
+        // вклады уже посчитаны, а граница слова — точный наибольший вклад
+        std::vector<TermCursor>& cursors = buffers.cursors;
+        cursors.clear();
+        for (const size_t slot : parsed_query.plus_terms) {
+            cursors.push_back({&decoded_terms_[slot], 0, PostingList::Cursor(GetPostings(decoded_terms_[slot]))});
+        }
+        std::vector<TermCursor*>& by_max_score = buffers.cursors_by_max_score;
+        by_max_score.clear();
+        for (TermCursor& cursor : cursors) {
+            by_max_score.push_back(&cursor);
+        }
+        std::sort(by_max_score.begin(), by_max_score.end(), [](const TermCursor* lhs, const TermCursor* rhs) {
+            return lhs->term->max_score < rhs->term->max_score;
+        });
+
+        const size_t top_count = MAX_RESULT_DOCUMENT_COUNT;
+        size_t essential_begin = 0;
+        double non_essential_score = 0.0;
+        double threshold = -std::numeric_limits<double>::infinity();
+        std::priority_queue<double, std::vector<double>, std::greater<>> top_relevances;
+        std::vector<Document> documents;
+        while (true) {
+            int ordinal = std::numeric_limits<int>::max();
+            for (size_t i = essential_begin; i < by_max_score.size(); ++i) {
+                if (!by_max_score[i]->IsEnd()) {
+                    ordinal = std::min(ordinal, by_max_score[i]->GetOrdinal());
+                }
+            }
+            if (ordinal == std::numeric_limits<int>::max()) {
+                break;
+            }
+            double max_relevance = non_essential_score;
+            for (size_t i = essential_begin; i < by_max_score.size(); ++i) {
+                if (!by_max_score[i]->IsEnd() && by_max_score[i]->GetOrdinal() == ordinal) {
+                    max_relevance += by_max_score[i]->GetScore(search_server_);
+                }
+            }
+            const bool is_candidate = max_relevance >= threshold - EPSILON && buffers.excluded_marks[ordinal] != mark
+                                      && search_server_.statuses_[ordinal] == DocumentStatus::ACTUAL;
+            double relevance = 0.0;
+            for (TermCursor& cursor : cursors) {
+                if (is_candidate) {
+                    cursor.SkipTo(ordinal);
+                }
+                if (!cursor.IsEnd() && cursor.GetOrdinal() == ordinal) {
+                    relevance += cursor.GetScore(search_server_);
+                    cursor.Next();
+                }
+            }
+            if (!is_candidate) {
+                continue;
+            }
+            documents.emplace_back(search_server_.ordinal_to_document_id_[ordinal], relevance,
+                                   search_server_.ratings_[ordinal]);
+            top_relevances.push(relevance);
+            if (top_relevances.size() > top_count) {
+                top_relevances.pop();
+            }
+            if (top_relevances.size() == top_count && top_relevances.top() > threshold) {
+                threshold = top_relevances.top();
+                while (essential_begin < by_max_score.size()
+                       && non_essential_score + by_max_score[essential_begin]->term->max_score < threshold - EPSILON) {
+                    non_essential_score += by_max_score[essential_begin]->term->max_score;
+                    ++essential_begin;
+                }
+            }
+        }
+        return documents;
+    }
+};
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
+                                                  const std::vector<std::string>& queries) {
+    return BatchQueryExecutor(search_server).FindTopDocuments(queries, 0, queries.size());
 }
 
-std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
-    auto docs = ProcessQueries(search_server,queries);
-    int size = std::transform_reduce(std::execution::par, docs.cbegin(), docs.cend(),0, std::plus<>(),
-          [](const std::vector<Document>& doc){ return doc.size();});
-    std::vector<Document> result (size);
-    int id = 0;
-    for (auto& v: docs) {
-        for (auto& doc: v) {
-            result[id++] = std::move(doc);
+struct JoinedDocuments::Pipeline {
+    const SearchServer& search_server;
+    const std::vector<std::string>& queries;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    // Документы готовых пачек запросов, каждая пачка — одним вектором
+    std::deque<std::vector<Document>> ready_batches;
+    bool is_stopped = false;
+    bool is_done = false;
+    std::exception_ptr error;
+
+    std::thread producer;
+
+    Pipeline(const SearchServer& search_server, const std::vector<std::string>& queries)
+            : search_server(search_server), queries(queries), producer([this] { Produce(); }) {
+    }
+
+    ~Pipeline() {
+        {
+            std::lock_guard guard(mutex);
+            is_stopped = true;
+        }
+        cv.notify_all();
+        producer.join();
+    }
+
+    void Produce() {
+        try {
+            for (size_t begin = 0; begin < queries.size(); begin += JOINED_QUERY_BATCH_SIZE) {
+                const size_t end = std::min(queries.size(), begin + JOINED_QUERY_BATCH_SIZE);
+                const auto documents_by_query = BatchQueryExecutor(search_server)
+                        .FindTopDocuments(queries, begin, end);
+                std::vector<Document> documents;
+                {
+                    MEASURE_STAGE(RESULT_COPY);
+                    for (const auto& query_documents : documents_by_query) {
+                        documents.insert(documents.end(), query_documents.begin(), query_documents.end());
+                    }
+                }
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] { return is_stopped || ready_batches.size() < JOINED_PIPELINE_DEPTH; });
+                if (is_stopped) {
+                    return;
+                }
+                ready_batches.push_back(std::move(documents));
+                cv.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard guard(mutex);
+            error = std::current_exception();
+        }
+        std::lock_guard guard(mutex);
+        is_done = true;
+        cv.notify_all();
+    }
+
+    // Ждёт следующую пачку; false, если пачек больше не будет
+    bool Pop(std::vector<Document>& documents) {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [this] { return !ready_batches.empty() || is_done; });
+        if (ready_batches.empty()) {
+            if (error) {
+                std::rethrow_exception(std::exchange(error, nullptr));
+            }
+            return false;
         }
+        documents = std::move(ready_batches.front());
+        ready_batches.pop_front();
+        cv.notify_all();
+        return true;
+    }
+};
+
+JoinedDocuments::Iterator::Iterator(JoinedDocuments* documents) : documents_(documents) {
+}
+
+JoinedDocuments::Iterator::reference JoinedDocuments::Iterator::operator*() const {
+    return documents_->batch_[documents_->position_];
+}
+
+JoinedDocuments::Iterator::pointer JoinedDocuments::Iterator::operator->() const {
+    return &**this;
+}
+
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++() {
+    if (!documents_->Advance()) {
+        documents_ = nullptr;
     }
-    return result;
+    return *this;
+}
+
+bool JoinedDocuments::Iterator::operator==(const Iterator& other) const {
+    return documents_ == other.documents_;
+}
+
+bool JoinedDocuments::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+JoinedDocuments::JoinedDocuments(const SearchServer& search_server, const std::vector<std::string>& queries)
+        : pipeline_(std::make_unique<Pipeline>(search_server, queries)) {
+}
+
+JoinedDocuments::JoinedDocuments(JoinedDocuments&&) noexcept = default;
+
+JoinedDocuments& JoinedDocuments::operator=(JoinedDocuments&&) noexcept = default;
+
+JoinedDocuments::~JoinedDocuments() = default;
+
+JoinedDocuments::Iterator JoinedDocuments::begin() {
+    if (!is_started_) {
+        is_started_ = true;
+        position_ = 0;
+        if (!LoadBatch()) {
+            return end();
+        }
+    }
+    return Iterator(position_ < batch_.size() ? this : nullptr);
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() {
+    return Iterator(nullptr);
+}
+
+bool JoinedDocuments::Advance() {
+    if (++position_ < batch_.size()) {
+        return true;
+    }
+    position_ = 0;
+    return LoadBatch();
+}
+
+bool JoinedDocuments::LoadBatch() {
+    // Запросы пачки могли не найти ни одного документа
+    do {
+        if (!pipeline_->Pop(batch_)) {
+            batch_.clear();
+            return false;
+        }
+    } while (batch_.empty());
+    return true;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    return JoinedDocuments(search_server, queries);
 }
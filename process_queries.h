@@ -1,10 +1,83 @@
 #pragma once
 
+#include <iterator>
+#include <memory>
 #include <vector>
 
 #include "document.h"
 #include "search_server.h"
 
+// Запросы ProcessQueriesJoined выполняются пачками такого размера
+constexpr size_t JOINED_QUERY_BATCH_SIZE = 256;
+// Сколько готовых пачек может ждать чтения
+constexpr size_t JOINED_PIPELINE_DEPTH = 2;
+
+// Все вызовы делят один пул потоков на процесс. Одновременные вызовы, в том числе фоновый поток
+// ProcessQueriesJoined, не ускоряют друг друга: их этапы выполняются на пуле по очереди
 std::vector<std::vector<Document>> ProcessQueries( const SearchServer& search_server,
                                                    const std::vector<std::string>& queries);
-std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+
+// Документы всех запросов подряд в порядке запросов. Фоновый поток выполняет запросы пачками
+// и опережает чтение не больше чем на JOINED_PIPELINE_DEPTH пачек, поэтому первые документы
+// доступны до окончания поиска, а память не растёт с числом запросов. Диапазон однопроходный,
+// ошибка в запросе бросается при переходе к его пачке. search_server и queries должны жить,
+// пока диапазон не разрушен
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        reference operator*() const;
+
+        pointer operator->() const;
+
+        Iterator& operator++();
+
+        bool operator==(const Iterator& other) const;
+
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        friend class JoinedDocuments;
+
+        // nullptr у итератора за концом
+        JoinedDocuments* documents_;
+
+        explicit Iterator(JoinedDocuments* documents);
+    };
+
+    JoinedDocuments(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+    JoinedDocuments(const SearchServer& search_server, std::vector<std::string>&& queries) = delete;
+
+    JoinedDocuments(JoinedDocuments&&) noexcept;
+
+    JoinedDocuments& operator=(JoinedDocuments&&) noexcept;
+
+    ~JoinedDocuments();
+
+    Iterator begin();
+
+    Iterator end();
+
+private:
+    struct Pipeline;
+
+    std::unique_ptr<Pipeline> pipeline_;
+    std::vector<Document> batch_;
+    size_t position_ = 0;
+    bool is_started_ = false;
+
+    bool Advance();
+
+    bool LoadBatch();
+};
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, std::vector<std::string>&& queries) = delete;
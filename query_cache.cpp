@@ -0,0 +1,132 @@
+#include "query_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// Слова не содержат управляющих символов, поэтому они годятся для разделения частей ключа
+constexpr char KEY_PART_SEPARATOR = '\x01';
+
+}  // namespace
+
+QueryCache::QueryCache(size_t capacity, size_t shard_count)
+        : shards_(std::clamp<size_t>(shard_count, 1, std::max<size_t>(capacity, 1))) {
+    // Остаток от деления достаётся первым шардам, поэтому сумма ёмкостей равна capacity
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i].capacity = capacity / shards_.size() + (i < capacity % shards_.size() ? 1 : 0);
+    }
+}
+
+std::vector<Document> QueryCache::FindTopDocuments(const SearchServer& search_server, std::string_view raw_query,
+                                                   DocumentStatus status, size_t top_count) {
+    const auto start_time = std::chrono::steady_clock::now();
+    std::string key = MakeKey(search_server, raw_query, status, top_count);
+    std::vector<Document> documents;
+    if (Find(key, search_server.generation_, documents)) {
+        ++hit_count_;
+        hit_nanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_time).count();
+        return documents;
+    }
+    documents = search_server.FindTopDocuments(raw_query, status, top_count);
+    Insert(std::move(key), search_server.generation_, documents);
+    ++miss_count_;
+    miss_nanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+    return documents;
+}
+
+QueryCache::Stats QueryCache::GetStats() const {
+    Stats stats;
+    stats.hit_count = hit_count_;
+    stats.miss_count = miss_count_;
+    if (stats.hit_count + stats.miss_count > 0) {
+        stats.hit_rate = double(stats.hit_count) / (stats.hit_count + stats.miss_count);
+    }
+    if (stats.hit_count > 0) {
+        stats.average_hit_latency = std::chrono::nanoseconds(hit_nanoseconds_ / stats.hit_count);
+    }
+    if (stats.miss_count > 0) {
+        stats.average_miss_latency = std::chrono::nanoseconds(miss_nanoseconds_ / stats.miss_count);
+    }
+    return stats;
+}
+
+size_t QueryCache::GetSize() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        shard.key_to_entry.clear();
+        shard.entries.clear();
+    }
+}
+
+std::string QueryCache::MakeKey(const SearchServer& search_server, std::string_view raw_query, DocumentStatus status,
+                                size_t top_count) {
+    const auto query = search_server.ParseQuery(raw_query);
+    std::string key;
+    for (std::string_view word : query.plus_words) {
+        key += word;
+        key += ' ';
+    }
+    key += KEY_PART_SEPARATOR;
+    for (std::string_view word : query.minus_words) {
+        key += word;
+        key += ' ';
+    }
+    key += KEY_PART_SEPARATOR;
+    key += std::to_string(static_cast<int>(status));
+    key += KEY_PART_SEPARATOR;
+    key += std::to_string(top_count);
+    return key;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+bool QueryCache::Find(const std::string& key, uint64_t generation, std::vector<Document>& documents) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.key_to_entry.find(key);
+    if (it == shard.key_to_entry.end()) {
+        return false;
+    }
+    const auto entry = it->second;
+    if (entry->generation != generation) {
+        return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+    documents = entry->documents;
+    return true;
+}
+
+void QueryCache::Insert(std::string key, uint64_t generation, const std::vector<Document>& documents) {
+    Shard& shard = GetShard(key);
+    if (shard.capacity == 0) {
+        return;
+    }
+    std::lock_guard guard(shard.mutex);
+    // Устаревшая запись того же запроса заменяется свежей
+    const auto it = shard.key_to_entry.find(key);
+    if (it != shard.key_to_entry.end()) {
+        const auto entry = it->second;
+        shard.key_to_entry.erase(it);
+        shard.entries.erase(entry);
+    }
+    if (shard.entries.size() == shard.capacity) {
+        shard.key_to_entry.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+    }
+    shard.entries.push_front({std::move(key), generation, documents});
+    shard.key_to_entry.emplace(shard.entries.front().key, shard.entries.begin());
+}
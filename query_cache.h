@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "search_server.h"
+
+constexpr size_t DEFAULT_QUERY_CACHE_SHARD_COUNT = 16;
+
+// Кеш результатов FindTopDocuments со статусом, разбитый на шарды со своими мьютексами и LRU-списками.
+// Ключ строится по разобранному запросу: плюс- и минус-слова без стоп-слов и повторов
+// в алфавитном порядке, статус и число документов, поэтому порядок и повторы слов не важны.
+// Запись помнит номер состояния индекса и считается устаревшей после любого изменения сервера.
+// Один кеш можно разделить между потоками и между серверами
+class QueryCache {
+public:
+    struct Stats {
+        uint64_t hit_count = 0;
+        uint64_t miss_count = 0;
+        double hit_rate = 0.0;
+        std::chrono::nanoseconds average_hit_latency{0};
+        std::chrono::nanoseconds average_miss_latency{0};
+    };
+
+    // capacity — наибольшее число запросов в кеше, оно делится между шардами поровну.
+    // Шардов не больше, чем capacity, чтобы у каждого было место хотя бы для одного запроса
+    explicit QueryCache(size_t capacity, size_t shard_count = DEFAULT_QUERY_CACHE_SHARD_COUNT);
+
+    std::vector<Document> FindTopDocuments(const SearchServer& search_server, std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    Stats GetStats() const;
+
+    size_t GetSize() const;
+
+    void Clear();
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        size_t capacity = 0;
+        // Свежие записи в начале списка
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> key_to_entry;
+    };
+
+    std::vector<Shard> shards_;
+
+    std::atomic<uint64_t> hit_count_ = 0;
+    std::atomic<uint64_t> miss_count_ = 0;
+    std::atomic<uint64_t> hit_nanoseconds_ = 0;
+    std::atomic<uint64_t> miss_nanoseconds_ = 0;
+
+    static std::string MakeKey(const SearchServer& search_server, std::string_view raw_query, DocumentStatus status,
+                               size_t top_count);
+
+    Shard& GetShard(const std::string& key);
+
+    bool Find(const std::string& key, uint64_t generation, std::vector<Document>& documents);
+
+    void Insert(std::string key, uint64_t generation, const std::vector<Document>& documents);
+};
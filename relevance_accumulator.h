@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+#include "document.h"
+
+// Столько номеров документов обрабатывает одна задача параллельного поиска: плотный накопитель
+// отрезка (32 КБ релевантностей) помещается в кэш ядра
+constexpr int RELEVANCE_RANGE_SIZE = 4096;
+
+// Плотный накопитель релевантности для отрезка номеров [begin, end) длиной не больше RELEVANCE_RANGE_SIZE.
+// Значения лежат в массивах потока по смещению номера от начала отрезка, без поиска и блокировок
+class RelevanceRange {
+public:
+    RelevanceRange(int begin, int end, std::vector<double>& relevances, std::vector<char>& is_matched)
+            : begin_(begin), end_(end), relevances_(relevances), is_matched_(is_matched) {
+        std::fill(relevances_.begin(), relevances_.end(), 0.0);
+        std::fill(is_matched_.begin(), is_matched_.end(), false);
+    }
+
+    int GetBegin() const {
+        return begin_;
+    }
+
+    int GetEnd() const {
+        return end_;
+    }
+
+    // Документ считается найденным, даже если вклад слова нулевой, как в последовательной версии
+    void Add(int ordinal, double relevance) {
+        relevances_[ordinal - begin_] += relevance;
+        is_matched_[ordinal - begin_] = true;
+    }
+
+    // function(ordinal, relevance) вызывается для найденных документов по возрастанию номера
+    template<typename Function>
+    void ForEachMatched(Function function) const {
+        for (int ordinal = begin_; ordinal < end_; ++ordinal) {
+            if (is_matched_[ordinal - begin_]) {
+                function(ordinal, relevances_[ordinal - begin_]);
+            }
+        }
+    }
+
+private:
+    int begin_;
+    int end_;
+    std::vector<double>& relevances_;
+    std::vector<char>& is_matched_;
+};
+
+// Номера [0, ordinal_count) делятся на отрезки, и каждый отрезок целиком обрабатывает одна задача
+// в плотном накопителе своего потока. Потоки не делят ни памяти, ни блокировок, а слияние —
+// это склейка результатов отрезков по порядку.
+// accumulate(range) добавляет вклады слов запроса в порядке слов, поэтому релевантность документа
+// складывается так же, как в последовательной версии, и совпадает с ней до бита.
+// make_document(ordinal, relevance) строит результат, документы идут по возрастанию номера
+template<typename Accumulate, typename MakeDocument>
+std::vector<Document> AccumulateRelevanceByRanges(int ordinal_count, Accumulate accumulate,
+                                                  MakeDocument make_document) {
+    std::vector<int> range_begins((ordinal_count + RELEVANCE_RANGE_SIZE - 1) / RELEVANCE_RANGE_SIZE);
+    for (size_t i = 0; i < range_begins.size(); ++i) {
+        range_begins[i] = static_cast<int>(i) * RELEVANCE_RANGE_SIZE;
+    }
+    std::vector<std::vector<Document>> range_documents(range_begins.size());
+    std::for_each(std::execution::par, range_begins.begin(), range_begins.end(), [&](int begin) {
+        thread_local std::vector<double> relevances(RELEVANCE_RANGE_SIZE);
+        thread_local std::vector<char> is_matched(RELEVANCE_RANGE_SIZE);
+        RelevanceRange range(begin, std::min(begin + RELEVANCE_RANGE_SIZE, ordinal_count), relevances, is_matched);
+        accumulate(range);
+        auto& documents = range_documents[begin / RELEVANCE_RANGE_SIZE];
+        range.ForEachMatched([&documents, &make_document](int ordinal, double relevance) {
+            documents.push_back(make_document(ordinal, relevance));
+        });
+    });
+
+    std::vector<size_t> document_offsets(range_documents.size() + 1);
+    std::transform_inclusive_scan(range_documents.begin(), range_documents.end(), document_offsets.begin() + 1,
+                                  std::plus<>(), [](const std::vector<Document>& documents) {
+                                      return documents.size();
+                                  });
+    std::vector<Document> matched_documents(document_offsets.back());
+    std::for_each(std::execution::par, range_begins.begin(), range_begins.end(), [&](int begin) {
+        const size_t range_index = begin / RELEVANCE_RANGE_SIZE;
+        std::copy(range_documents[range_index].begin(), range_documents[range_index].end(),
+                  matched_documents.begin() + document_offsets[range_index]);
+    });
+    return matched_documents;
+}
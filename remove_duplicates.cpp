@@ -0,0 +1,267 @@
+#include "remove_duplicates.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Перемешивание splitmix64: различные входы дают различные и равномерно распределённые значения
+uint64_t MixHash(uint64_t value) {
+    value += 0x9E3779B97F4A7C15;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+    return value ^ (value >> 31);
+}
+
+struct Fingerprint {
+    uint64_t low;
+    uint64_t high;
+
+    bool operator==(const Fingerprint& other) const {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator<(const Fingerprint& other) const {
+        return low < other.low || (low == other.low && high < other.high);
+    }
+};
+
+// Подпись MinHash из MINHASH_BAND_COUNT полос по MINHASH_BAND_ROWS значений. Документы с мерой
+// Жаккара s совпадают хотя бы в одной полосе с вероятностью 1 - (1 - s^8)^16: 0.9999 при s = 0.9,
+// 0.95 при s = 0.8 и 0.001 при s = 0.3. Широкие полосы отсекают документы, похожие только частыми
+// словами, иначе кандидатов становится квадратично много
+constexpr size_t MINHASH_BAND_COUNT = 16;
+constexpr size_t MINHASH_BAND_ROWS = 8;
+
+using BandKeys = std::array<uint64_t, MINHASH_BAND_COUNT>;
+
+}  // namespace
+
+// Ищет дубликаты по прямому индексу сервера, не изменяя его
+class DuplicateFinder {
+public:
+    explicit DuplicateFinder(const SearchServer& search_server)
+            : search_server_(search_server), document_ids_(GetSortedDocumentIds(search_server)) {
+    }
+
+    template<typename ExecutionPolicy>
+    std::vector<int> FindDuplicates(ExecutionPolicy&& policy) const {
+        struct DocumentFingerprint {
+            Fingerprint fingerprint;
+            int document_id;
+        };
+
+        std::vector<DocumentFingerprint> fingerprints(document_ids_.size());
+        std::transform(policy, document_ids_.begin(), document_ids_.end(), fingerprints.begin(),
+                       [this](int document_id) {
+                           return DocumentFingerprint{ComputeFingerprint(GetTermCounts(document_id)), document_id};
+                       });
+        // В группе с одним отпечатком первым идёт документ с меньшим id
+        std::sort(policy, fingerprints.begin(), fingerprints.end(),
+                  [](const DocumentFingerprint& lhs, const DocumentFingerprint& rhs) {
+                      return lhs.fingerprint < rhs.fingerprint
+                             || (lhs.fingerprint == rhs.fingerprint && lhs.document_id < rhs.document_id);
+                  });
+
+        std::vector<int> duplicate_ids;
+        std::vector<int> kept_ids;
+        for (size_t group_begin = 0; group_begin < fingerprints.size();) {
+            size_t group_end = group_begin + 1;
+            while (group_end < fingerprints.size()
+                   && fingerprints[group_end].fingerprint == fingerprints[group_begin].fingerprint) {
+                ++group_end;
+            }
+            // Совпадение отпечатков без совпадения наборов не должно удалить документ
+            kept_ids.clear();
+            for (size_t i = group_begin; i < group_end; ++i) {
+                const int document_id = fingerprints[i].document_id;
+                const bool is_duplicate = std::any_of(kept_ids.begin(), kept_ids.end(), [&](int kept_id) {
+                    return HasSameTerms(GetTermCounts(kept_id), GetTermCounts(document_id));
+                });
+                if (is_duplicate) {
+                    duplicate_ids.push_back(document_id);
+                } else {
+                    kept_ids.push_back(document_id);
+                }
+            }
+            group_begin = group_end;
+        }
+        std::sort(duplicate_ids.begin(), duplicate_ids.end());
+        return duplicate_ids;
+    }
+
+    template<typename ExecutionPolicy>
+    std::vector<int> FindNearDuplicates(ExecutionPolicy&& policy, double min_similarity) const {
+        std::vector<BandKeys> band_keys(document_ids_.size());
+        std::transform(policy, document_ids_.begin(), document_ids_.end(), band_keys.begin(),
+                       [this](int document_id) {
+                           return ComputeBandKeys(GetTermCounts(document_id));
+                       });
+
+        // Документы просматриваются по возрастанию id и сравниваются только с оставленными
+        // документами, у которых совпала хотя бы одна полоса
+        std::unordered_map<uint64_t, std::vector<size_t>> kept_by_band;
+        std::vector<int> duplicate_ids;
+        // Номер документа, для которого кандидат уже проверен: кандидат может совпасть в нескольких полосах
+        std::vector<size_t> checked_for(document_ids_.size(), document_ids_.size());
+        for (size_t index = 0; index < document_ids_.size(); ++index) {
+            const auto& term_counts = GetTermCounts(document_ids_[index]);
+            bool is_duplicate = false;
+            for (const uint64_t band_key : band_keys[index]) {
+                const auto kept_it = kept_by_band.find(band_key);
+                if (kept_it == kept_by_band.end()) {
+                    continue;
+                }
+                for (const size_t kept_index : kept_it->second) {
+                    if (checked_for[kept_index] == index) {
+                        continue;
+                    }
+                    checked_for[kept_index] = index;
+                    if (ComputeSimilarity(GetTermCounts(document_ids_[kept_index]), term_counts) >= min_similarity) {
+                        is_duplicate = true;
+                        break;
+                    }
+                }
+                if (is_duplicate) {
+                    break;
+                }
+            }
+            if (is_duplicate) {
+                duplicate_ids.push_back(document_ids_[index]);
+            } else {
+                for (const uint64_t band_key : band_keys[index]) {
+                    kept_by_band[band_key].push_back(index);
+                }
+            }
+        }
+        return duplicate_ids;
+    }
+
+private:
+    using TermCounts = std::vector<SearchServer::TermCount>;
+
+    const SearchServer& search_server_;
+    // По возрастанию
+    const std::vector<int> document_ids_;
+
+    static std::vector<int> GetSortedDocumentIds(const SearchServer& search_server) {
+        std::vector<int> document_ids(search_server.begin(), search_server.end());
+        std::sort(document_ids.begin(), document_ids.end());
+        return document_ids;
+    }
+
+    const TermCounts& GetTermCounts(int document_id) const {
+        return search_server_.ordinal_to_term_counts_[search_server_.document_id_to_ordinal_.at(document_id)];
+    }
+
+    // Слова в прямом индексе отсортированы по номеру, поэтому равные наборы дают равные отпечатки.
+    // Половины считаются независимыми цепочками с разными начальными значениями
+    static Fingerprint ComputeFingerprint(const TermCounts& term_counts) {
+        Fingerprint fingerprint{MixHash(term_counts.size()), MixHash(~uint64_t(term_counts.size()))};
+        for (const auto& term_count : term_counts) {
+            const uint64_t term = static_cast<uint32_t>(term_count.term_id);
+            fingerprint.low = MixHash(fingerprint.low ^ term);
+            fingerprint.high = MixHash(fingerprint.high + (term << 32 | term));
+        }
+        return fingerprint;
+    }
+
+    static bool HasSameTerms(const TermCounts& lhs, const TermCounts& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.term_id == rhs.term_id;
+        });
+    }
+
+    // Мера Жаккара наборов слов, у двух пустых документов — 1
+    static double ComputeSimilarity(const TermCounts& lhs, const TermCounts& rhs) {
+        size_t common_count = 0;
+        for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin(); lhs_it != lhs.end() && rhs_it != rhs.end();) {
+            if (lhs_it->term_id < rhs_it->term_id) {
+                ++lhs_it;
+            } else if (rhs_it->term_id < lhs_it->term_id) {
+                ++rhs_it;
+            } else {
+                ++common_count;
+                ++lhs_it;
+                ++rhs_it;
+            }
+        }
+        const size_t union_count = lhs.size() + rhs.size() - common_count;
+        return union_count == 0 ? 1.0 : static_cast<double>(common_count) / union_count;
+    }
+
+    // Значение i подписи — наименьший хеш слов документа при i-й хеш-функции. Ключ полосы
+    // включает её номер, поэтому одинаковые значения в разных полосах не совпадают
+    static BandKeys ComputeBandKeys(const TermCounts& term_counts) {
+        std::array<uint64_t, MINHASH_BAND_COUNT * MINHASH_BAND_ROWS> signature;
+        signature.fill(std::numeric_limits<uint64_t>::max());
+        for (const auto& term_count : term_counts) {
+            const uint64_t term_hash = MixHash(static_cast<uint32_t>(term_count.term_id));
+            for (size_t i = 0; i < signature.size(); ++i) {
+                // Полного перемешивания не нужно: term_hash уже равномерен, достаточно сделать значения
+                // разных функций независимыми
+                uint64_t value = (term_hash ^ (i * 0x9E3779B97F4A7C15)) * 0xBF58476D1CE4E5B9;
+                value ^= value >> 31;
+                signature[i] = std::min(signature[i], value);
+            }
+        }
+        BandKeys band_keys;
+        for (size_t band = 0; band < MINHASH_BAND_COUNT; ++band) {
+            uint64_t band_key = MixHash(band);
+            for (size_t row = 0; row < MINHASH_BAND_ROWS; ++row) {
+                band_key = MixHash(band_key ^ signature[band * MINHASH_BAND_ROWS + row]);
+            }
+            band_keys[band] = band_key;
+        }
+        return band_keys;
+    }
+};
+
+namespace {
+
+void CheckSimilarity(double min_similarity) {
+    if (!(min_similarity >= 0 && min_similarity <= 1)) {
+        throw std::invalid_argument("Similarity must be between 0 and 1");
+    }
+}
+
+}  // namespace
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server) {
+    return RemoveDuplicates(std::execution::seq, search_server);
+}
+
+std::vector<int> RemoveDuplicates(const std::execution::sequenced_policy& policy, SearchServer& search_server) {
+    const std::vector<int> duplicate_ids = DuplicateFinder(search_server).FindDuplicates(policy);
+    search_server.RemoveDocuments(policy, duplicate_ids);
+    return duplicate_ids;
+}
+
+std::vector<int> RemoveDuplicates(const std::execution::parallel_policy& policy, SearchServer& search_server) {
+    const std::vector<int> duplicate_ids = DuplicateFinder(search_server).FindDuplicates(policy);
+    search_server.RemoveDocuments(policy, duplicate_ids);
+    return duplicate_ids;
+}
+
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double min_similarity) {
+    return RemoveNearDuplicates(std::execution::seq, search_server, min_similarity);
+}
+
+std::vector<int> RemoveNearDuplicates(const std::execution::sequenced_policy& policy, SearchServer& search_server,
+                                      double min_similarity) {
+    CheckSimilarity(min_similarity);
+    const std::vector<int> duplicate_ids = DuplicateFinder(search_server).FindNearDuplicates(policy, min_similarity);
+    search_server.RemoveDocuments(policy, duplicate_ids);
+    return duplicate_ids;
+}
+
+std::vector<int> RemoveNearDuplicates(const std::execution::parallel_policy& policy, SearchServer& search_server,
+                                      double min_similarity) {
+    CheckSimilarity(min_similarity);
+    const std::vector<int> duplicate_ids = DuplicateFinder(search_server).FindNearDuplicates(policy, min_similarity);
+    search_server.RemoveDocuments(policy, duplicate_ids);
+    return duplicate_ids;
+}
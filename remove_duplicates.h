@@ -0,0 +1,29 @@
+#pragma once
+
+#include <execution>
+#include <vector>
+
+#include "search_server.h"
+
+// Удаляет документы, набор слов которых (без стоп-слов и без учёта числа вхождений) совпадает
+// с набором документа с меньшим id. Документы группируются по 128-битному отпечатку набора номеров
+// слов, совпадение отпечатков перепроверяется сравнением наборов. Возвращает id удалённых
+// документов по возрастанию
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
+
+std::vector<int> RemoveDuplicates(const std::execution::sequenced_policy&, SearchServer& search_server);
+
+std::vector<int> RemoveDuplicates(const std::execution::parallel_policy&, SearchServer& search_server);
+
+// Удаляет почти-дубликаты: документ удаляется, если мера Жаккара его набора слов и набора
+// оставленного документа с меньшим id не меньше min_similarity (от 0 до 1). Кандидаты ищутся
+// по MinHash-подписям, разбитым на полосы (LSH), мера для кандидатов считается точно.
+// Пары с мерой от 0.9 находятся почти всегда, с мерой 0.8 — в 95% случаев, а пары с мерой
+// ниже 0.6 редко становятся кандидатами, поэтому малое min_similarity находит не все пары
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double min_similarity);
+
+std::vector<int> RemoveNearDuplicates(const std::execution::sequenced_policy&, SearchServer& search_server,
+                                      double min_similarity);
+
+std::vector<int> RemoveNearDuplicates(const std::execution::parallel_policy&, SearchServer& search_server,
+                                      double min_similarity);
@@ -1,10 +1,17 @@
 #include "request_queue.h"
 
-constexpr int TRANSITION_TO_THE_NEXT_DAY = 2;
-
 RequestQueue::RequestQueue(const SearchServer& search_server) : server_(search_server) {}
 
+RequestQueue::RequestQueue(const SearchServer& search_server, QueryCache& cache)
+        : server_(search_server), cache_(&cache) {}
+
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    if (cache_ != nullptr) {
+        const auto start_time = std::chrono::steady_clock::now();
+        std::vector<Document> result_query = cache_->FindTopDocuments(server_, raw_query, status);
+        AddRequest(result_query.size(), std::chrono::steady_clock::now() - start_time);
+        return result_query;
+    }
     return AddFindRequest(raw_query, [status]([[maybe_unused]]int document_id, DocumentStatus document_status,
                                               [[maybe_unused]]int rating) {
         return document_status == status;
@@ -16,32 +23,53 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return empty_request;
+    std::lock_guard guard(mutex_);
+    return static_cast<int>(no_result_count_);
 }
 
-void RequestQueue::QueryDeque(const std::vector<Document>& result_query) {
-    CleanDeque();
-    QueryResult queryResult(result_query, (sec_query));
-    requests_.push_back(queryResult);
-    if (result_query.empty()) {
-        empty_request++;
+RequestQueue::Stats RequestQueue::GetStats() const {
+    std::lock_guard guard(mutex_);
+    Stats stats;
+    stats.request_count = request_count_;
+    stats.no_result_count = no_result_count_;
+    stats.result_count_histogram = result_count_histogram_;
+    stats.latency_p50 = std::chrono::nanoseconds(latency_histogram_.GetPercentile(0.5));
+    stats.latency_p90 = std::chrono::nanoseconds(latency_histogram_.GetPercentile(0.9));
+    stats.latency_p99 = std::chrono::nanoseconds(latency_histogram_.GetPercentile(0.99));
+    return stats;
+}
+
+void RequestQueue::AddRequest(size_t result_count, std::chrono::steady_clock::duration latency) {
+    const RequestRecord record{static_cast<uint32_t>(result_count), static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count())};
+    std::lock_guard guard(mutex_);
+    RequestRecord& slot = records_[next_record_index_];
+    if (request_count_ == REQUEST_WINDOW_SIZE) {
+        RemoveFromAggregates(slot);
+    } else {
+        ++request_count_;
     }
-    sec_query++;
-}
-
-void RequestQueue::CleanDeque() {
-    if (!requests_.empty()) {
-        int d = requests_.back().sec_of_query - requests_.begin()->sec_of_query;
-        if (d > sec_in_day_ - TRANSITION_TO_THE_NEXT_DAY) {
-            for (auto it = requests_.begin(); it != requests_.end(); ++it) {
-                if ((requests_.back().sec_of_query - requests_.front().sec_of_query) >
-                    sec_in_day_ - TRANSITION_TO_THE_NEXT_DAY) {
-                    requests_.pop_front();
-                    if (it->result.empty()) {
-                        --empty_request;
-                    }
-                }
-            }
-        }
+    slot = record;
+    AddToAggregates(slot);
+    next_record_index_ = (next_record_index_ + 1) % REQUEST_WINDOW_SIZE;
+}
+
+size_t RequestQueue::GetResultCountBucket(const RequestRecord& record) {
+    return std::min<size_t>(record.result_count, MAX_RESULT_DOCUMENT_COUNT);
+}
+
+void RequestQueue::AddToAggregates(const RequestRecord& record) {
+    if (record.result_count == 0) {
+        ++no_result_count_;
+    }
+    ++result_count_histogram_[GetResultCountBucket(record)];
+    latency_histogram_.Add(record.latency_nanoseconds);
+}
+
+void RequestQueue::RemoveFromAggregates(const RequestRecord& record) {
+    if (record.result_count == 0) {
+        --no_result_count_;
     }
-}
\ No newline at end of file
+    --result_count_histogram_[GetResultCountBucket(record)];
+    latency_histogram_.Remove(record.latency_nanoseconds);
+}
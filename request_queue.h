@@ -1,18 +1,40 @@
 #pragma once
 
-#include <deque>
+#include <array>
+#include <chrono>
+#include <mutex>
 
+#include "latency_histogram.h"
+#include "query_cache.h"
 #include "search_server.h"
 
+// Статистика считается по последним REQUEST_WINDOW_SIZE запросам (по запросу в минуту за сутки)
+constexpr size_t REQUEST_WINDOW_SIZE = 1440;
+
 class RequestQueue {
 public:
+    struct Stats {
+        size_t request_count = 0;
+        size_t no_result_count = 0;
+        // Число запросов с i найденными документами, в последней ячейке — с MAX_RESULT_DOCUMENT_COUNT и больше
+        std::array<size_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_count_histogram{};
+        std::chrono::nanoseconds latency_p50{0};
+        std::chrono::nanoseconds latency_p90{0};
+        std::chrono::nanoseconds latency_p99{0};
+    };
+
     explicit RequestQueue(const SearchServer& search_server);
 
-    // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
+    // Запросы со статусом отвечаются через cache, запросы с предикатом кешировать нельзя
+    RequestQueue(const SearchServer& search_server, QueryCache& cache);
+
+    // Запросы можно добавлять из нескольких потоков: поиск идёт без блокировки,
+    // под мьютексом только обновляется окно статистики
     template<typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+        const auto start_time = std::chrono::steady_clock::now();
         std::vector<Document> result_query = server_.FindTopDocuments(raw_query, document_predicate);
-        QueryDeque(result_query);
+        AddRequest(result_query.size(), std::chrono::steady_clock::now() - start_time);
         return result_query;
     }
 
@@ -22,24 +44,33 @@ public:
 
     int GetNoResultRequests() const;
 
+    Stats GetStats() const;
+
 private:
-    struct QueryResult {
-        QueryResult(const std::vector<Document> document, const int sec) {
-            result = document;
-            sec_of_query = sec;
-        }
-
-        std::vector<Document> result;
-        int sec_of_query = 0;
+    // Запись о запросе в окне: сами документы для статистики не нужны
+    struct RequestRecord {
+        uint32_t result_count;
+        uint64_t latency_nanoseconds;
     };
 
-    std::deque<QueryResult> requests_;
-    const static int sec_in_day_ = 1440;
-    int sec_query = 0;
-    int empty_request = 0;
     const SearchServer& server_;
+    QueryCache* cache_ = nullptr;
+
+    mutable std::mutex mutex_;
+    // Кольцевой буфер: новая запись вытесняет запись, вышедшую из окна
+    std::array<RequestRecord, REQUEST_WINDOW_SIZE> records_{};
+    size_t next_record_index_ = 0;
+    size_t request_count_ = 0;
+    // Сводки по записям окна обновляются за O(1) при добавлении и вытеснении
+    size_t no_result_count_ = 0;
+    std::array<size_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_count_histogram_{};
+    LatencyHistogram latency_histogram_;
+
+    void AddRequest(size_t result_count, std::chrono::steady_clock::duration latency);
+
+    static size_t GetResultCountBucket(const RequestRecord& record);
 
-    void QueryDeque(const std::vector<Document>& result_query);
+    void AddToAggregates(const RequestRecord& record);
 
-    void CleanDeque();
-};
\ No newline at end of file
+    void RemoveFromAggregates(const RequestRecord& record);
+};
@@ -1,5 +1,7 @@
 #include "search_server.h"
 
+#include <unordered_set>
+
 SearchServer::SearchServer(const std::string& stop_words_text) : SearchServer(SplitIntoWords(stop_words_text)) {
 }
 
@@ -8,26 +10,162 @@ SearchServer::SearchServer(std::string_view stop_words_text) : SearchServer(Spli
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
                                const std::vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || (document_id_to_ordinal_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    std::vector<TermCount> term_counts;
+    int word_count = 0;
+    for (const auto&[word, count] : ComputeWordCounts(document)) {
+        term_counts.push_back({terms_.Intern(word), count});
+        word_count += count;
+    }
+    std::sort(term_counts.begin(), term_counts.end(), [](const TermCount& lhs, const TermCount& rhs) {
+        return lhs.term_id < rhs.term_id;
+    });
+    AddDocumentTerms(document_id, std::move(term_counts), 1.0 / word_count, status, ComputeAverageRating(ratings));
+}
 
-    const double inv_word_count = 1.0 / words.size();
-    for (std::string_view word : words) {
-        word_to_document_freqs_[std::string(word)][document_id] += inv_word_count;
-        id_to_words_freqs[document_id][std::string(word)] += inv_word_count;
+void SearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy&, const std::vector<NewDocument>& documents) {
+    AddDocumentsBatch(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy&, const std::vector<NewDocument>& documents) {
+    AddDocumentsBatch(std::execution::par, documents);
+}
+
+template<typename ExecutionPolicy>
+void SearchServer::AddDocumentsBatch(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents) {
+    struct ParsedDocument {
+        // Слова, уже известные словарю, отсортированные по term_id
+        std::vector<TermCount> known_term_counts;
+        std::vector<std::pair<std::string_view, int>> new_word_counts;
+        int word_count = 0;
+        int rating = 0;
+        std::exception_ptr error;
+    };
+
+    // Разбор только читает индекс, поэтому документы разбираются параллельно
+    std::vector<ParsedDocument> parsed_documents(documents.size());
+    std::transform(policy, documents.begin(), documents.end(), parsed_documents.begin(),
+                   [this](const NewDocument& document) {
+                       ParsedDocument parsed;
+                       try {
+                           for (const auto&[word, count] : ComputeWordCounts(document.text)) {
+                               const TermId term_id = terms_.Find(word);
+                               if (term_id == NO_TERM) {
+                                   parsed.new_word_counts.push_back({word, count});
+                               } else {
+                                   parsed.known_term_counts.push_back({term_id, count});
+                               }
+                               parsed.word_count += count;
+                           }
+                       } catch (...) {
+                           parsed.error = std::current_exception();
+                       }
+                       std::sort(parsed.known_term_counts.begin(), parsed.known_term_counts.end(),
+                                 [](const TermCount& lhs, const TermCount& rhs) { return lhs.term_id < rhs.term_id; });
+                       parsed.rating = ComputeAverageRating(document.ratings);
+                       return parsed;
+                   });
+
+    std::unordered_set<int> batch_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = documents[i].id;
+        if (document_id < 0 || document_id_to_ordinal_.count(document_id) > 0
+            || !batch_ids.insert(document_id).second) {
+            throw std::invalid_argument("Invalid document_id");
+        }
+        if (parsed_documents[i].error) {
+            std::rethrow_exception(parsed_documents[i].error);
+        }
     }
 
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-    document_ids_.push_back(document_id);
+    // Новые слова получают номера больше всех известных, поэтому их достаточно отсортировать между собой
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ParsedDocument& parsed = parsed_documents[i];
+        std::vector<TermCount> term_counts = std::move(parsed.known_term_counts);
+        const size_t known_count = term_counts.size();
+        for (const auto&[word, count] : parsed.new_word_counts) {
+            term_counts.push_back({terms_.Intern(word), count});
+        }
+        std::sort(term_counts.begin() + known_count, term_counts.end(),
+                  [](const TermCount& lhs, const TermCount& rhs) { return lhs.term_id < rhs.term_id; });
+        AddDocumentTerms(documents[i].id, std::move(term_counts), 1.0 / parsed.word_count, documents[i].status,
+                         parsed.rating);
+    }
+}
+
+void SearchServer::AddDocumentTerms(int document_id, std::vector<TermCount> term_counts, double inv_word_count,
+                                    DocumentStatus status, int rating) {
+    // Новые слова получают постинги сразу, пустыми становятся только старые слова при удалении
+    const size_t known_term_count = term_postings_.size();
+    if (term_postings_.size() < terms_.GetTermCount()) {
+        term_postings_.resize(terms_.GetTermCount());
+        inverse_document_freqs_.resize(terms_.GetTermCount());
+        max_term_freqs_.resize(terms_.GetTermCount());
+    }
+    const int ordinal = static_cast<int>(ordinal_to_document_id_.size());
+    document_id_to_ordinal_.emplace(document_id, ordinal);
+    ordinal_to_document_id_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    inv_word_counts_.push_back(inv_word_count);
+    live_ordinals_.PushBack();
+    term_counts.shrink_to_fit();
+    for (const auto[term_id, count] : term_counts) {
+        if (static_cast<size_t>(term_id) < known_term_count && term_postings_[term_id].IsEmpty()) {
+            --empty_term_count_;
+        }
+        term_postings_[term_id].PushBack(ordinal, count);
+        max_term_freqs_[term_id] = std::max(max_term_freqs_[term_id], GetTermFreq(ordinal, count));
+    }
+    ordinal_to_term_counts_.push_back(std::move(term_counts));
+    generation_ = NextGeneration();
+}
+
+void SearchServer::MergeDocuments(const SearchServer& other, const std::set<int>& skipped_ids) {
+    // Номера слов другого словаря переводятся в свои один раз на слово, а не на каждое вхождение
+    std::vector<TermId> term_id_map(other.terms_.GetTermCount(), NO_TERM);
+    for (const int document_id : other) {
+        if (skipped_ids.count(document_id) > 0) {
+            continue;
+        }
+        if (document_id_to_ordinal_.count(document_id) > 0) {
+            throw std::invalid_argument("Invalid document_id");
+        }
+        const int other_ordinal = other.document_id_to_ordinal_.at(document_id);
+        std::vector<TermCount> term_counts;
+        term_counts.reserve(other.ordinal_to_term_counts_[other_ordinal].size());
+        for (const auto[other_term_id, count] : other.ordinal_to_term_counts_[other_ordinal]) {
+            TermId& term_id = term_id_map[other_term_id];
+            if (term_id == NO_TERM) {
+                term_id = terms_.Intern(other.terms_.GetTerm(other_term_id));
+            }
+            term_counts.push_back({term_id, count});
+        }
+        std::sort(term_counts.begin(), term_counts.end(), [](const TermCount& lhs, const TermCount& rhs) {
+            return lhs.term_id < rhs.term_id;
+        });
+        AddDocumentTerms(document_id, std::move(term_counts), other.inv_word_counts_[other_ordinal],
+                         other.statuses_[other_ordinal], other.ratings_[other_ordinal]);
+    }
+}
+
+int SearchServer::GetDocumentFreq(std::string_view word) const {
+    const TermId term_id = terms_.Find(word);
+    return term_id == NO_TERM ? 0 : static_cast<int>(term_postings_[term_id].GetSize());
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                     size_t top_count) const {
     return FindTopDocuments(raw_query, [status]([[maybe_unused]] int document_id, DocumentStatus document_status,
                                                 [[maybe_unused]] int rating) {
         return document_status == status;
-    });
+    }, top_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
@@ -35,19 +173,19 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
-                                                     DocumentStatus status) const {
+                                                     DocumentStatus status, size_t top_count) const {
     return FindTopDocuments(std::execution::seq, raw_query, [status]([[maybe_unused]] int document_id, DocumentStatus document_status,
                                                                      [[maybe_unused]] int rating) {
         return document_status == status;
-    });
+    }, top_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
-                                                     DocumentStatus status) const {
+                                                     DocumentStatus status, size_t top_count) const {
     return FindTopDocuments(std::execution::par, raw_query, [status]([[maybe_unused]] int document_id, DocumentStatus document_status,
                                                                      [[maybe_unused]] int rating) {
         return document_status == status;
-    });
+    }, top_count);
 }
 
 std::vector<Document>
@@ -61,11 +199,52 @@ SearchServer::FindTopDocuments(const std::execution::parallel_policy&, std::stri
 }
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_id_to_ordinal_.size();
 }
 
 int SearchServer::GetDocumentId(int index) const {
-    return document_ids_.at(index);
+    if (index < 0 || index >= GetDocumentCount()) {
+        throw std::out_of_range("Document index is out of range");
+    }
+    return ordinal_to_document_id_[live_ordinals_.FindByIndex(index)];
+}
+
+SearchServer::DocumentIdIterator SearchServer::begin() const {
+    return {this, 0};
+}
+
+SearchServer::DocumentIdIterator SearchServer::end() const {
+    return {this, static_cast<int>(live_ordinals_.GetOrdinalCount())};
+}
+
+SearchServer::DocumentIdIterator::DocumentIdIterator(const SearchServer* search_server, int ordinal)
+        : search_server_(search_server), ordinal_(ordinal) {
+    SkipRemoved();
+}
+
+int SearchServer::DocumentIdIterator::operator*() const {
+    return search_server_->ordinal_to_document_id_[ordinal_];
+}
+
+SearchServer::DocumentIdIterator& SearchServer::DocumentIdIterator::operator++() {
+    ++ordinal_;
+    SkipRemoved();
+    return *this;
+}
+
+bool SearchServer::DocumentIdIterator::operator==(const DocumentIdIterator& other) const {
+    return ordinal_ == other.ordinal_;
+}
+
+bool SearchServer::DocumentIdIterator::operator!=(const DocumentIdIterator& other) const {
+    return !(*this == other);
+}
+
+void SearchServer::DocumentIdIterator::SkipRemoved() {
+    const LiveOrdinals& live_ordinals = search_server_->live_ordinals_;
+    while (static_cast<size_t>(ordinal_) < live_ordinals.GetOrdinalCount() && !live_ordinals.IsLive(ordinal_)) {
+        ++ordinal_;
+    }
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query,
@@ -73,9 +252,61 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     return MatchDocument(std::execution::seq, raw_query, document_id);
 }
 
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query,
+                            int document_id) const {
+    const auto query = ParseQuery(raw_query);
+    const int ordinal = document_id_to_ordinal_.at(document_id);
+    for (std::string_view word : query.minus_words) {
+        const TermId term_id = terms_.Find(word);
+        if (term_id != NO_TERM && HasTerm(ordinal, term_id)) {
+            return {std::vector<std::string_view>(), statuses_[ordinal]};
+        }
+    }
+    std::vector<std::string_view> matched_words;
+    for (std::string_view word : query.plus_words) {
+        const TermId term_id = terms_.Find(word);
+        if (term_id != NO_TERM && HasTerm(ordinal, term_id)) {
+            matched_words.push_back(terms_.GetTerm(term_id));
+        }
+    }
+    return {matched_words, statuses_[ordinal]};
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query,
+                            int document_id) const {
+    const auto query = ParseQuery(raw_query);
+    const int ordinal = document_id_to_ordinal_.at(document_id);
+    const auto contains = [this, ordinal](std::string_view word) {
+        const TermId term_id = terms_.Find(word);
+        return term_id != NO_TERM && HasTerm(ordinal, term_id);
+    };
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), contains)) {
+        return {std::vector<std::string_view>(), statuses_[ordinal]};
+    }
+    // Каждый поток пишет только в свою ячейку заранее выделенного вектора. Слова запроса
+    // уже упорядочены и различны, поэтому после удаления пустых ячеек результат отсортирован
+    std::vector<std::string_view> matched_words(query.plus_words.GetSize());
+    std::transform(std::execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
+                   [this, ordinal](std::string_view word) {
+                       const TermId term_id = terms_.Find(word);
+                       return term_id != NO_TERM && HasTerm(ordinal, term_id) ? terms_.GetTerm(term_id)
+                                                                              : std::string_view();
+                   });
+    matched_words.erase(std::remove(matched_words.begin(), matched_words.end(), std::string_view()),
+                        matched_words.end());
+    return {matched_words, statuses_[ordinal]};
+}
+
+
+uint64_t SearchServer::NextGeneration() {
+    static std::atomic<uint64_t> last_generation = 0;
+    return ++last_generation;
+}
 
 bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(std::string(word)) > 0;
+    return stop_words_.count(word) > 0;
 }
 
 bool SearchServer::IsValidWord(std::string_view word) {
@@ -85,18 +316,29 @@ bool SearchServer::IsValidWord(std::string_view word) {
 }
 
 std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word " + std::string(word) + " is invalid");
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
-        }
+    // Управляющие символы ищутся при разбиении текста, отдельно слова не проверяются
+    auto[words, first_invalid_word] = Tokenize(text);
+    if (first_invalid_word < words.size()) {
+        throw std::invalid_argument("Word " + std::string(words[first_invalid_word]) + " is invalid");
     }
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) { return IsStopWord(word); }),
+                words.end());
     return words;
 }
 
+std::vector<std::pair<std::string_view, int>> SearchServer::ComputeWordCounts(std::string_view text) const {
+    auto words = SplitIntoWordsNoStop(text);
+    std::sort(words.begin(), words.end());
+    std::vector<std::pair<std::string_view, int>> word_counts;
+    for (std::string_view word : words) {
+        if (word_counts.empty() || word_counts.back().first != word) {
+            word_counts.push_back({word, 0});
+        }
+        ++word_counts.back().second;
+    }
+    return word_counts;
+}
+
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -108,6 +350,25 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
+double SearchServer::GetTermFreq(int ordinal, int count) const {
+    return count * inv_word_counts_[ordinal];
+}
+
+bool SearchServer::HasTerm(int ordinal, TermId term_id) const {
+    const auto& term_counts = ordinal_to_term_counts_[ordinal];
+    return std::binary_search(term_counts.begin(), term_counts.end(), TermCount{term_id, 0},
+                              [](const TermCount& lhs, const TermCount& rhs) { return lhs.term_id < rhs.term_id; });
+}
+
+int SearchServer::FindTermCount(int ordinal, TermId term_id) const {
+    const auto& term_counts = ordinal_to_term_counts_[ordinal];
+    const auto it = std::lower_bound(term_counts.begin(), term_counts.end(), TermCount{term_id, 0},
+                                     [](const TermCount& lhs, const TermCount& rhs) {
+                                         return lhs.term_id < rhs.term_id;
+                                     });
+    return it != term_counts.end() && it->term_id == term_id ? it->count : 0;
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
     if (text.empty()) {
         throw std::invalid_argument("Query word is empty");
@@ -126,39 +387,208 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 }
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+    MEASURE_STAGE(PARSE);
     Query result;
-    const auto word_vector = SplitIntoWords(text);
-    for (std::string_view word : word_vector) {
-        auto query_word = ParseQueryWord(word);
+    // Слова выделяются из текста так же, как в SplitIntoWords, но без промежуточного вектора
+    while (true) {
+        const size_t space = text.find(' ');
+        const QueryWord query_word = ParseQueryWord(text.substr(0, space));
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
-                result.minus_words.emplace(query_word.data);
+                result.minus_words.PushBack(query_word.data);
             } else {
-                result.plus_words.emplace(query_word.data);
+                result.plus_words.PushBack(query_word.data);
             }
         }
+        if (space == text.npos) {
+            break;
+        }
+        text.remove_prefix(space + 1);
     }
+    // Слова обходятся в алфавитном порядке, как раньше, чтобы релевантность складывалась в том же порядке
+    SortUniqueWords(result.plus_words);
+    SortUniqueWords(result.minus_words);
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(double(GetDocumentCount()) / word_to_document_freqs_.at(word).size());
+void SearchServer::SortUniqueWords(QueryWords& words) {
+    std::sort(words.begin(), words.end());
+    words.Truncate(std::unique(words.begin(), words.end()) - words.begin());
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const {
+    CachedInverseDocumentFreq& cached = inverse_document_freqs_[term_id];
+    if (cached.generation.load(std::memory_order_acquire) == generation_) {
+        return cached.value.load(std::memory_order_relaxed);
+    }
+    const double inverse_document_freq = log(double(GetDocumentCount()) / term_postings_[term_id].GetSize());
+    cached.value.store(inverse_document_freq, std::memory_order_relaxed);
+    cached.generation.store(generation_, std::memory_order_release);
+    return inverse_document_freq;
+}
+
+DocumentBitmap SearchServer::FindExcludedDocuments(const Query& query) const {
+    MEASURE_STAGE(MINUS_EXCLUSION);
+    DocumentBitmap excluded_documents;
+    for (std::string_view word : query.minus_words) {
+        const TermId term_id = terms_.Find(word);
+        if (term_id == NO_TERM || term_postings_[term_id].IsEmpty()) {
+            continue;
+        }
+        if (excluded_documents.IsEmpty()) {
+            excluded_documents = DocumentBitmap(ordinal_to_document_id_.size());
+        }
+        term_postings_[term_id].ForEach([&excluded_documents](int ordinal, int) {
+            excluded_documents.Insert(ordinal);
+        });
+    }
+    return excluded_documents;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
     RemoveDocument(std::execution::seq, document_id);
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static std::map<std::string_view, double> empty_map; // пустой контейнер для возврата в случае отсутствия document_id
-    if (id_to_words_freqs.count(document_id) == 0) {
-        return empty_map;
+void SearchServer::CompactOrdinalsIfNeeded() {
+    const size_t removed_count = live_ordinals_.GetOrdinalCount() - live_ordinals_.GetLiveCount();
+    if (removed_count < MIN_COMPACTED_ORDINAL_COUNT || removed_count <= live_ordinals_.GetLiveCount()) {
+        return;
+    }
+    std::vector<int> new_ordinals(ordinal_to_document_id_.size(), -1);
+    std::vector<int> ordinal_to_document_id;
+    std::vector<int> ratings;
+    std::vector<DocumentStatus> statuses;
+    std::vector<double> inv_word_counts;
+    std::vector<std::vector<TermCount>> ordinal_to_term_counts;
+    LiveOrdinals live_ordinals;
+    for (size_t ordinal = 0; ordinal < ordinal_to_document_id_.size(); ++ordinal) {
+        if (!live_ordinals_.IsLive(static_cast<int>(ordinal))) {
+            continue;
+        }
+        new_ordinals[ordinal] = static_cast<int>(ordinal_to_document_id.size());
+        document_id_to_ordinal_[ordinal_to_document_id_[ordinal]] = new_ordinals[ordinal];
+        ordinal_to_document_id.push_back(ordinal_to_document_id_[ordinal]);
+        ratings.push_back(ratings_[ordinal]);
+        statuses.push_back(statuses_[ordinal]);
+        inv_word_counts.push_back(inv_word_counts_[ordinal]);
+        ordinal_to_term_counts.push_back(std::move(ordinal_to_term_counts_[ordinal]));
+        live_ordinals.PushBack();
+    }
+    // Новые номера возрастают вместе со старыми, поэтому постинги дописываются в том же порядке
+    for (PostingList& postings : term_postings_) {
+        PostingList compacted_postings;
+        postings.ForEach([&compacted_postings, &new_ordinals](int ordinal, int count) {
+            compacted_postings.PushBack(new_ordinals[ordinal], count);
+        });
+        postings = std::move(compacted_postings);
+    }
+    ordinal_to_document_id_ = std::move(ordinal_to_document_id);
+    ratings_ = std::move(ratings);
+    statuses_ = std::move(statuses);
+    inv_word_counts_ = std::move(inv_word_counts);
+    ordinal_to_term_counts_ = std::move(ordinal_to_term_counts);
+    live_ordinals_ = std::move(live_ordinals);
+}
+
+void SearchServer::CollectEmptyTermsIfNeeded() {
+    if (empty_term_count_ < MIN_COLLECTED_TERM_COUNT || empty_term_count_ * 2 <= terms_.GetTermCount()) {
+        return;
+    }
+    TermDictionary terms;
+    std::vector<TermId> new_term_ids(terms_.GetTermCount(), NO_TERM);
+    std::vector<PostingList> term_postings;
+    std::vector<double> max_term_freqs;
+    for (size_t term_id = 0; term_id < term_postings_.size(); ++term_id) {
+        if (term_postings_[term_id].IsEmpty()) {
+            continue;
+        }
+        new_term_ids[term_id] = terms.Intern(terms_.GetTerm(static_cast<TermId>(term_id)));
+        term_postings.push_back(std::move(term_postings_[term_id]));
+        max_term_freqs.push_back(max_term_freqs_[term_id]);
+    }
+    for (auto& term_counts : ordinal_to_term_counts_) {
+        for (TermCount& term_count : term_counts) {
+            term_count.term_id = new_term_ids[term_count.term_id];
+        }
+    }
+    terms_ = std::move(terms);
+    term_postings_ = std::move(term_postings);
+    max_term_freqs_ = std::move(max_term_freqs);
+    // Кэш IDF индексирован номерами слов, он заполнится заново
+    inverse_document_freqs_ = std::vector<CachedInverseDocumentFreq>(terms_.GetTermCount());
+    empty_term_count_ = 0;
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+SearchServer::WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const auto ordinal_it = document_id_to_ordinal_.find(document_id);
+    if (ordinal_it == document_id_to_ordinal_.end()) {
+        return {};
     }
-    static std::map<std::string_view , double> map_;
-    for (const auto& doc: id_to_words_freqs.at(document_id)) {
-        map_[doc.first] = doc.second;
+    return {this, ordinal_it->second};
+}
+
+SearchServer::WordFrequencies::WordFrequencies(const SearchServer* search_server, int ordinal)
+        : search_server_(search_server), ordinal_(ordinal) {
+    const auto& term_counts = search_server->ordinal_to_term_counts_[ordinal];
+    begin_ = term_counts.data();
+    end_ = term_counts.data() + term_counts.size();
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::begin() const {
+    return {search_server_, ordinal_, begin_};
+}
+
+SearchServer::WordFrequencies::Iterator SearchServer::WordFrequencies::end() const {
+    return {search_server_, ordinal_, end_};
+}
+
+size_t SearchServer::WordFrequencies::size() const {
+    return end_ - begin_;
+}
+
+bool SearchServer::WordFrequencies::empty() const {
+    return begin_ == end_;
+}
+
+double SearchServer::WordFrequencies::GetFrequency(std::string_view word) const {
+    if (empty()) {
+        return 0.0;
+    }
+    const TermId term_id = search_server_->terms_.Find(word);
+    const TermCount* term_count = std::lower_bound(begin_, end_, term_id, [](const TermCount& lhs, TermId rhs) {
+        return lhs.term_id < rhs;
+    });
+    if (term_id == NO_TERM || term_count == end_ || term_count->term_id != term_id) {
+        return 0.0;
     }
-    return map_;
+    return search_server_->GetTermFreq(ordinal_, term_count->count);
+}
+
+SearchServer::WordFrequencies::Iterator::Iterator(const SearchServer* search_server, int ordinal,
+                                                  const TermCount* term_count)
+        : search_server_(search_server), ordinal_(ordinal), term_count_(term_count) {
+}
+
+SearchServer::WordFrequencies::Iterator::value_type SearchServer::WordFrequencies::Iterator::operator*() const {
+    return {search_server_->terms_.GetTerm(term_count_->term_id),
+            search_server_->GetTermFreq(ordinal_, term_count_->count)};
+}
+
+SearchServer::WordFrequencies::Iterator& SearchServer::WordFrequencies::Iterator::operator++() {
+    ++term_count_;
+    return *this;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator==(const Iterator& other) const {
+    return term_count_ == other.term_count_;
+}
+
+bool SearchServer::WordFrequencies::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
 }
 
 
@@ -2,16 +2,29 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <cmath>
 #include <algorithm>
 #include <execution>
 #include <atomic>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <type_traits>
 
 #include "document.h"
+#include "document_bitmap.h"
+#include "live_ordinals.h"
+#include "posting_list.h"
+#include "relevance_accumulator.h"
+#include "small_vector.h"
+#include "stage_latency.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
 
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
-constexpr double EPSILON = 1e-6;
 
 class SearchServer {
 public:
@@ -31,57 +44,61 @@ public:
     void
     AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Пакетная загрузка: документы разбираются параллельно, а постинги дописываются за один проход.
+    // Ошибки те же, что у AddDocument, и проверяются в порядке документов, но до изменения индекса:
+    // если хоть один документ некорректен, не добавляется ни один
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    void AddDocuments(const std::execution::sequenced_policy&, const std::vector<NewDocument>& documents);
+
+    void AddDocuments(const std::execution::parallel_policy&, const std::vector<NewDocument>& documents);
+
     template<typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-        return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_count);
     }
 
     template<typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
-                                           DocumentPredicate document_predicate) const {
+                                           DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
         const auto query = ParseQuery(raw_query);
-        std::vector<Document> matched_documents;
-        matched_documents = FindAllDocuments(std::execution::seq, query, document_predicate);
-
-        sort(std::execution::seq, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-        if (int(matched_documents.size()) > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        // Если нужны все документы, порога для отсечения не будет, и полный перебор дешевле
+        if (top_count < static_cast<size_t>(GetDocumentCount())) {
+            return FindTopDocumentsPruned(query, document_predicate, top_count);
+        }
+        auto matched_documents = FindAllDocuments(std::execution::seq, query, document_predicate);
+        {
+            MEASURE_STAGE(TOP_K);
+            SelectTopDocuments(std::execution::seq, matched_documents, top_count);
         }
-
         return matched_documents;
     }
 
     template<typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
-                                           DocumentPredicate document_predicate) const {
+                                           DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
         const auto query = ParseQuery(raw_query);
         auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
-        sort(std::execution::par, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-        if (int(matched_documents.size()) > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        {
+            MEASURE_STAGE(TOP_K);
+            SelectTopDocuments(std::execution::par, matched_documents, top_count);
         }
         return matched_documents;
     }
 
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document>
-    FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status) const;
+    FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query, DocumentStatus status,
+                     size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document>
-    FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status) const;
+    FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query, DocumentStatus status,
+                     size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
@@ -91,66 +108,131 @@ public:
 
     int GetDocumentCount() const;
 
+    // id документа по его позиции в порядке добавления, O(log n)
     int GetDocumentId(int index) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus>
     MatchDocument(std::string_view raw_query, int document_id) const;
 
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+
+    // Остальные политики сводятся к двум версиям выше: par_unseq — к параллельной, unseq — к последовательной
     template<typename ExecutionPolicy>
     std::tuple<std::vector<std::string_view>, DocumentStatus>
-    MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const {
-        static auto query = ParseQuery(raw_query);
-        std::vector<std::string_view> matched_words;
-        std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-                      [document_id, &matched_words, this](const std::string& word) {
-                          if (id_to_words_freqs.at(document_id).count(word)) {
-                              matched_words.push_back(word);
-                          }
-                      });
-        for (const std::string& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.clear();
-                break;
-            }
+    MatchDocument(ExecutionPolicy&&, std::string_view raw_query, int document_id) const {
+        using Policy = std::decay_t<ExecutionPolicy>;
+        static_assert(std::is_execution_policy_v<Policy>, "MatchDocument expects an execution policy");
+        if constexpr (std::is_same_v<Policy, std::execution::parallel_policy>
+                      || std::is_same_v<Policy, std::execution::parallel_unsequenced_policy>) {
+            return MatchDocument(std::execution::par, raw_query, document_id);
+        } else {
+            return MatchDocument(std::execution::seq, raw_query, document_id);
         }
-        return {matched_words, documents_.at(document_id).status};
     }
 
+    class WordFrequencies;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Представление поверх прямого индекса: ничего не копирует и создаётся за O(1).
+    // Действительно, пока сервер не изменён
+    WordFrequencies GetWordFrequencies(int document_id) const;
 
+    // Слова, оставшиеся без документов, убираются из словаря, когда их становится больше половины.
+    // После этого string_view слов, полученные от сервера раньше, недействительны
     void RemoveDocument(int document_id);
 
     template<typename ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy&& policy, int document_id) {
-        if (id_to_words_freqs.count(document_id) == 1) {
-            auto find_id = find(policy, document_ids_.begin(), document_ids_.end(), document_id);
-            document_ids_.erase(find_id);
-            documents_.erase(document_id);
-            std::for_each(policy, word_to_document_freqs_.begin(), word_to_document_freqs_.end(), [document_id]
-                    (auto& doc) {
-                doc.second.erase(document_id);
+        if (document_id_to_ordinal_.count(document_id) == 1) {
+            const int ordinal = document_id_to_ordinal_.at(document_id);
+            live_ordinals_.Erase(ordinal);
+            // Постинги ищутся только у слов самого документа. Слова в прямом индексе различны,
+            // поэтому параллельные потоки изменяют разные списки
+            auto& term_counts = ordinal_to_term_counts_[ordinal];
+            std::for_each(policy, term_counts.begin(), term_counts.end(), [this, ordinal](const TermCount& term_count) {
+                term_postings_[term_count.term_id].Erase(ordinal);
             });
-            id_to_words_freqs.erase(document_id);
+            for (const TermCount& term_count : term_counts) {
+                empty_term_count_ += term_postings_[term_count.term_id].IsEmpty();
+            }
+            // Номер документа больше не используется, освобождаем только его прямой индекс
+            term_counts = {};
+            document_id_to_ordinal_.erase(document_id);
+            generation_ = NextGeneration();
+            CompactOrdinalsIfNeeded();
+            CollectEmptyTermsIfNeeded();
         }
     }
 
-    auto begin() {
-        return document_ids_.begin();
-    }
+    // Удаляет документы разом: список постингов каждого затронутого слова перекодируется один раз,
+    // а не при удалении каждого документа. Отсутствующие id пропускаются
+    void RemoveDocuments(const std::vector<int>& document_ids);
 
-    auto end() {
-        return document_ids_.end();
+    template<typename ExecutionPolicy>
+    void RemoveDocuments(ExecutionPolicy&& policy, const std::vector<int>& document_ids) {
+        // После сортировки удаляемые постинги каждого слова идут подряд по возрастанию номера
+        std::vector<std::pair<TermId, int>> removed_postings;
+        bool is_removed = false;
+        for (const int document_id : document_ids) {
+            const auto ordinal_it = document_id_to_ordinal_.find(document_id);
+            if (ordinal_it == document_id_to_ordinal_.end()) {
+                continue;
+            }
+            const int ordinal = ordinal_it->second;
+            for (const TermCount& term_count : ordinal_to_term_counts_[ordinal]) {
+                removed_postings.emplace_back(term_count.term_id, ordinal);
+            }
+            ordinal_to_term_counts_[ordinal] = {};
+            live_ordinals_.Erase(ordinal);
+            document_id_to_ordinal_.erase(ordinal_it);
+            is_removed = true;
+        }
+        if (!is_removed) {
+            return;
+        }
+        std::sort(policy, removed_postings.begin(), removed_postings.end());
+        std::vector<size_t> term_begins;
+        for (size_t i = 0; i < removed_postings.size(); ++i) {
+            if (i == 0 || removed_postings[i].first != removed_postings[i - 1].first) {
+                term_begins.push_back(i);
+            }
+        }
+        // Каждый поток изменяет списки своих слов
+        std::for_each(policy, term_begins.begin(), term_begins.end(), [this, &removed_postings](size_t begin) {
+            const TermId term_id = removed_postings[begin].first;
+            std::vector<int> ordinals;
+            for (size_t i = begin; i < removed_postings.size() && removed_postings[i].first == term_id; ++i) {
+                ordinals.push_back(removed_postings[i].second);
+            }
+            term_postings_[term_id].Erase(ordinals);
+        });
+        for (const size_t begin : term_begins) {
+            empty_term_count_ += term_postings_[removed_postings[begin].first].IsEmpty();
+        }
+        generation_ = NextGeneration();
+        CompactOrdinalsIfNeeded();
+        CollectEmptyTermsIfNeeded();
     }
 
+    class DocumentIdIterator;
+
+    // id документов в порядке добавления
+    DocumentIdIterator begin() const;
+
+    DocumentIdIterator end() const;
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
+    // Сегменты SegmentedSearchServer ищутся вместе, поэтому ему нужны разбор запроса и оценка
+    // документов с IDF, посчитанным по всем сегментам
+    friend class SegmentedSearchServer;
+    friend class MappedSearchServer;
+    friend class QueryCache;
+    friend class BatchQueryExecutor;
+    friend class DuplicateFinder;
+    friend void SaveIndex(const SearchServer& search_server, const std::string& path);
 
     struct QueryWord {
         std::string_view data;
@@ -158,17 +240,89 @@ private:
         bool is_stop;
     };
 
+    // Короткий запрос разбирается без обращений к куче
+    static constexpr size_t QUERY_WORD_INLINE_COUNT = 16;
+
+    using QueryWords = SmallVector<std::string_view, QUERY_WORD_INLINE_COUNT>;
+
+    // Слова ссылаются на текст запроса, отсортированы и различны
     struct Query {
-        std::set<std::string, std::less<>> plus_words;
-        std::set<std::string, std::less<>> minus_words;
+        QueryWords plus_words;
+        QueryWords minus_words;
     };
 
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::vector<int> document_ids_;
-    std::map<int, std::map<std::string, double>> id_to_words_freqs;
+    // IDF слова, посчитанный для состояния индекса с номером generation (0 — ещё не считался).
+    // Поиск может идти из нескольких потоков, но одновременно с ним индекс не меняется, поэтому
+    // все потоки записывают для одного номера одно и то же значение
+    struct CachedInverseDocumentFreq {
+        std::atomic<uint64_t> generation = 0;
+        std::atomic<double> value = 0.0;
 
+        CachedInverseDocumentFreq() = default;
+
+        CachedInverseDocumentFreq(const CachedInverseDocumentFreq& other)
+                : generation(other.generation.load(std::memory_order_acquire)),
+                  value(other.value.load(std::memory_order_relaxed)) {
+        }
+    };
+
+    // Элемент прямого индекса: слово документа и число его вхождений
+    struct TermCount {
+        TermId term_id;
+        int count;
+    };
+
+    const std::set<std::string, std::less<>> stop_words_;
+    // Каждое слово хранится один раз в словаре, индексы ссылаются на него по номеру
+    TermDictionary terms_;
+    // Постинги хранят число вхождений слова, а не частоту: частота восстанавливается
+    // по числу вхождений и длине документа. Номера выдаются по возрастанию, поэтому новые
+    // постинги всегда дописываются в конец списка
+    std::vector<PostingList> term_postings_;
+    // Слова словаря, у которых не осталось постингов
+    size_t empty_term_count_ = 0;
+
+    // Внешний id документа один раз отображается в плотный внутренний номер (ordinal).
+    // Метаданные документа лежат в параллельных массивах, индексируемых этим номером.
+    // Номера удалённых документов не переиспользуются, их нет в document_id_to_ordinal_ и в постингах.
+    // Когда удалённых номеров становится больше живых, живые перенумеровываются подряд, поэтому
+    // массивы занимают не больше двух номеров на живой документ (но не меньше MIN_COMPACTED_ORDINAL_COUNT)
+    std::unordered_map<int, int> document_id_to_ordinal_;
+    std::vector<int> ordinal_to_document_id_;
+    LiveOrdinals live_ordinals_;
+    std::vector<int> ratings_;
+    std::vector<DocumentStatus> statuses_;
+    // 1 / число слов документа без стоп-слов
+    std::vector<double> inv_word_counts_;
+    // Слова документа, отсортированные по term_id
+    std::vector<std::vector<TermCount>> ordinal_to_term_counts_;
+
+    // Номер состояния индекса, общий для всех серверов: новый сервер и каждое изменение получают
+    // следующий номер, а копия сохраняет номер оригинала. Равные номера означают одинаковое содержимое
+    uint64_t generation_ = NextGeneration();
+
+    // IDF пересчитывается лениво: при первом запросе со словом после изменения индекса
+    mutable std::vector<CachedInverseDocumentFreq> inverse_document_freqs_;
+    // Наибольшая частота слова среди добавленных документов. После удаления документов
+    // значение не уменьшается и остаётся верхней границей
+    std::vector<double> max_term_freqs_;
+
+
+    // Пустых слов должно набраться столько, чтобы пересборка словаря окупалась
+    static constexpr size_t MIN_COLLECTED_TERM_COUNT = 1024;
+
+    // Удалённых номеров должно набраться столько, чтобы перенумерация окупалась
+    static constexpr size_t MIN_COMPACTED_ORDINAL_COUNT = 1024;
+
+    static uint64_t NextGeneration();
+
+    // Перенумеровывает живые документы подряд с сохранением порядка, если удалённых номеров больше
+    // живых. Порядок номеров в постингах при этом не меняется, списки просто перекодируются
+    void CompactOrdinalsIfNeeded();
+
+    // Убирает из словаря слова без постингов, если их больше половины. Номера оставшихся слов
+    // сдвигаются с сохранением порядка, поэтому прямой индекс остаётся отсортированным
+    void CollectEmptyTermsIfNeeded();
 
     bool IsStopWord(std::string_view word) const;
 
@@ -176,14 +330,142 @@ private:
 
     std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
+    // Слова текста без стоп-слов с числом вхождений, упорядоченные по слову
+    std::vector<std::pair<std::string_view, int>> ComputeWordCounts(std::string_view text) const;
+
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // term_counts должны быть отсортированы по term_id, слова уже добавлены в словарь
+    void AddDocumentTerms(int document_id, std::vector<TermCount> term_counts, double inv_word_count,
+                          DocumentStatus status, int rating);
+
+    // Добавляет документы другого сервера с теми же стоп-словами, кроме skipped_ids.
+    // Частоты слов переносятся как есть, поэтому релевантность не меняется
+    void MergeDocuments(const SearchServer& other, const std::set<int>& skipped_ids);
+
+    int GetDocumentFreq(std::string_view word) const;
+
+    template<typename ExecutionPolicy>
+    void AddDocumentsBatch(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents);
+
+    // Одно умножение на заранее посчитанную обратную длину документа
+    double GetTermFreq(int ordinal, int count) const;
+
+    bool HasTerm(int ordinal, TermId term_id) const;
+
+    // Число вхождений слова в документ, 0 — если слова в документе нет
+    int FindTermCount(int ordinal, TermId term_id) const;
+
     QueryWord ParseQueryWord(std::string_view text) const;
 
     Query ParseQuery(std::string_view text) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    static void SortUniqueWords(QueryWords& words);
+
+    double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+    // Документы с минус-словами запроса отмечаются до оценки, чтобы не считать их релевантность
+    DocumentBitmap FindExcludedDocuments(const Query& query) const;
+
+    // Поиск документ за документом с отсечением (MaxScore). Вклад слова в релевантность не больше
+    // его наибольшей частоты, умноженной на IDF. Когда найдено top_count документов, слова с самыми
+    // малыми границами, которые вместе не поднимут документ до порога top_count-й релевантности,
+    // перестают перебираться: документы берутся только из списков остальных слов, а редкие слова
+    // проверяются по прямому индексу. Документ, чья граница ниже порога больше чем на EPSILON,
+    // не оценивается полностью: он не обойдёт ни один из top_count документов даже по рейтингу.
+    // Вклады складываются в алфавитном порядке слов, как в FindAllDocuments, поэтому
+    // релевантность найденных документов совпадает с полным перебором до бита
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPruned(const Query& query, DocumentPredicate document_predicate,
+                                                 size_t top_count) const {
+        struct ScoredTerm {
+            TermId term_id;
+            double inverse_document_freq;
+        };
+
+        struct QueryTerm {
+            size_t scored_index;
+            double max_score;
+            PostingList::Cursor cursor;
+        };
+
+        // Слова без постингов ничего не добавляют, и их IDF не определён
+        std::vector<ScoredTerm> scored_terms;
+        std::vector<QueryTerm> query_terms;
+        for (std::string_view word : query.plus_words) {
+            const TermId term_id = terms_.Find(word);
+            if (term_id == NO_TERM || term_postings_[term_id].IsEmpty()) {
+                continue;
+            }
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+            query_terms.push_back({scored_terms.size(), max_term_freqs_[term_id] * inverse_document_freq,
+                                   PostingList::Cursor(term_postings_[term_id])});
+            scored_terms.push_back({term_id, inverse_document_freq});
+        }
+        const DocumentBitmap excluded_documents = FindExcludedDocuments(query);
+        std::sort(query_terms.begin(), query_terms.end(), [](const QueryTerm& lhs, const QueryTerm& rhs) {
+            return lhs.max_score < rhs.max_score;
+        });
+
+        // Слова до essential_begin перебирать не нужно, их границы вместе не больше non_essential_score
+        size_t essential_begin = 0;
+        double non_essential_score = 0.0;
+        double threshold = -std::numeric_limits<double>::infinity();
+        std::priority_queue<double, std::vector<double>, std::greater<>> top_relevances;
+        std::vector<Document> matched_documents;
+        {
+            MEASURE_STAGE(POSTING_TRAVERSAL);
+            while (true) {
+                int ordinal = std::numeric_limits<int>::max();
+                for (size_t i = essential_begin; i < query_terms.size(); ++i) {
+                    if (!query_terms[i].cursor.IsEnd()) {
+                        ordinal = std::min(ordinal, query_terms[i].cursor.GetOrdinal());
+                    }
+                }
+                if (ordinal == std::numeric_limits<int>::max()) {
+                    break;
+                }
+                double max_relevance = non_essential_score;
+                for (size_t i = essential_begin; i < query_terms.size(); ++i) {
+                    PostingList::Cursor& cursor = query_terms[i].cursor;
+                    if (!cursor.IsEnd() && cursor.GetOrdinal() == ordinal) {
+                        max_relevance += GetTermFreq(ordinal, cursor.GetCount())
+                                         * scored_terms[query_terms[i].scored_index].inverse_document_freq;
+                        cursor.Next();
+                    }
+                }
+                if (max_relevance < threshold - EPSILON || excluded_documents.Contains(ordinal)
+                    || !document_predicate(ordinal_to_document_id_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                    continue;
+                }
+                double relevance = 0.0;
+                for (const auto[term_id, inverse_document_freq] : scored_terms) {
+                    const int count = FindTermCount(ordinal, term_id);
+                    if (count > 0) {
+                        relevance += GetTermFreq(ordinal, count) * inverse_document_freq;
+                    }
+                }
+                matched_documents.emplace_back(ordinal_to_document_id_[ordinal], relevance, ratings_[ordinal]);
+                top_relevances.push(relevance);
+                if (top_relevances.size() > top_count) {
+                    top_relevances.pop();
+                }
+                if (top_count > 0 && top_relevances.size() == top_count && top_relevances.top() > threshold) {
+                    threshold = top_relevances.top();
+                    while (essential_begin < query_terms.size()
+                           && non_essential_score + query_terms[essential_begin].max_score < threshold - EPSILON) {
+                        non_essential_score += query_terms[essential_begin].max_score;
+                        ++essential_begin;
+                    }
+                }
+            }
+        }
+        {
+            MEASURE_STAGE(TOP_K);
+            SelectTopDocuments(std::execution::seq, matched_documents, top_count);
+        }
+        return matched_documents;
+    }
 
     template<typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
@@ -193,30 +475,42 @@ private:
     template<typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
                                            DocumentPredicate document_predicate) const {
+        return FindAllDocuments(std::execution::seq, query, document_predicate,
+                                [this](std::string_view, TermId term_id) {
+                                    return ComputeWordInverseDocumentFreq(term_id);
+                                });
+    }
+
+    // inverse_document_freq_of(word, term_id) возвращает IDF слова запроса, которое есть в словаре
+    template<typename DocumentPredicate, typename InverseDocumentFreq>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query,
+                                           DocumentPredicate document_predicate,
+                                           InverseDocumentFreq inverse_document_freq_of) const {
+        const DocumentBitmap excluded_documents = FindExcludedDocuments(query);
         std::map<int, double> document_to_relevance;
-        for (const std::string& word : query.plus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto[document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        {
+            MEASURE_STAGE(POSTING_TRAVERSAL);
+            for (std::string_view word : query.plus_words) {
+                const TermId term_id = terms_.Find(word);
+                if (term_id == NO_TERM) {
+                    continue;
                 }
-            }
-        }
-        for (const std::string& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            for (const auto[document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+                const double inverse_document_freq = inverse_document_freq_of(word, term_id);
+                term_postings_[term_id].ForEach([&](int ordinal, int count) {
+                    if (!excluded_documents.Contains(ordinal)
+                        && document_predicate(ordinal_to_document_id_[ordinal], statuses_[ordinal],
+                                              ratings_[ordinal])) {
+                        document_to_relevance[ordinal] += GetTermFreq(ordinal, count) * inverse_document_freq;
+                    }
+                });
             }
         }
         std::vector<Document> matched_documents;
-        for (const auto[document_id, relevance] : document_to_relevance) {
-            matched_documents.emplace_back(Document(document_id, relevance, documents_.at(document_id).rating));
+        {
+            MEASURE_STAGE(RESULT_COPY);
+            for (const auto[ordinal, relevance] : document_to_relevance) {
+                matched_documents.emplace_back(ordinal_to_document_id_[ordinal], relevance, ratings_[ordinal]);
+            }
         }
         return matched_documents;
     }
@@ -224,43 +518,116 @@ private:
     template<typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query& query,
                                            DocumentPredicate document_predicate) const {
-        std::map<int, double> document_to_relevance;
-        std::for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(), // да понимаю, что ни самое удачное решение в 3 этажа,
-                      // но самое понтятное,прошедшее тест,  на основе последовательного решения,
-                      // если разложить по порядку
-                      [this, &document_to_relevance, &document_predicate](const std::string& word) {
-                          if (word_to_document_freqs_.count(word) != 0) {
-                              const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                              std::for_each(std::execution::par, word_to_document_freqs_.at(word).begin(),
-                                            word_to_document_freqs_.at(word).end(),
-                                            [this, &document_to_relevance, &document_predicate, &inverse_document_freq]
-                                                    (const std::pair<int, double>& docs) {
-                                                const auto& document_data = documents_.at(docs.first);
-                                                if (document_predicate(docs.first, document_data.status,
-                                                                       document_data.rating)) {
-                                                    document_to_relevance[docs.first] +=
-                                                            docs.second * inverse_document_freq;
-                                                }
-                                            });
-                          };
-                      });
-
-        for (const std::string& word : query.minus_words) {
-            if (word_to_document_freqs_.count(word) == 0) {
-                continue;
-            }
-            for (const auto[document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        const DocumentBitmap excluded_documents = FindExcludedDocuments(query);
+        std::vector<std::pair<TermId, double>> query_terms;
+        for (std::string_view word : query.plus_words) {
+            const TermId term_id = terms_.Find(word);
+            if (term_id != NO_TERM) {
+                query_terms.emplace_back(term_id, ComputeWordInverseDocumentFreq(term_id));
             }
         }
-        std::vector<Document> matched_documents;
-        matched_documents.resize(document_to_relevance.size());
-        std::atomic_size_t size = 0;
-        std::for_each(std::execution::par, document_to_relevance.begin(), document_to_relevance.end(),
-                      [this, &matched_documents, &size](const std::pair<int, double>& document) {
-                          matched_documents[size++] = Document(document.first, document.second,
-                                                               documents_.at(document.first).rating);;
-                      });
-        return matched_documents;
+        // Каждая задача проходит свой отрезок номеров по всем словам в порядке запроса
+        MEASURE_STAGE(POSTING_TRAVERSAL);
+        return AccumulateRelevanceByRanges(
+                static_cast<int>(ordinal_to_document_id_.size()),
+                [this, &query_terms, &document_predicate, &excluded_documents](RelevanceRange& range) {
+                    for (const auto& query_term : query_terms) {
+                        const double inverse_document_freq = query_term.second;
+                        const auto add_posting = [&](int ordinal, int count) {
+                            if (!excluded_documents.Contains(ordinal)
+                                && document_predicate(ordinal_to_document_id_[ordinal], statuses_[ordinal],
+                                                      ratings_[ordinal])) {
+                                range.Add(ordinal, GetTermFreq(ordinal, count) * inverse_document_freq);
+                            }
+                        };
+                        term_postings_[query_term.first].ForEachInRange(range.GetBegin(), range.GetEnd(),
+                                                                        add_posting);
+                    }
+                },
+                [this](int ordinal, double relevance) {
+                    return Document(ordinal_to_document_id_[ordinal], relevance, ratings_[ordinal]);
+                });
     }
-};
\ No newline at end of file
+};
+
+// Слова документа и их частоты в порядке номеров слов в словаре, а не по алфавиту. Пары
+// вычисляются при разыменовании итератора. У отсутствующего документа представление пустое
+class SearchServer::WordFrequencies {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const;
+
+        Iterator& operator++();
+
+        bool operator==(const Iterator& other) const;
+
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        friend class WordFrequencies;
+
+        const SearchServer* search_server_;
+        int ordinal_;
+        const TermCount* term_count_;
+
+        Iterator(const SearchServer* search_server, int ordinal, const TermCount* term_count);
+    };
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Частота слова, 0 — если слова в документе нет. Слово ищется двоичным поиском по прямому индексу
+    double GetFrequency(std::string_view word) const;
+
+private:
+    friend class SearchServer;
+
+    const SearchServer* search_server_ = nullptr;
+    int ordinal_ = 0;
+    const TermCount* begin_ = nullptr;
+    const TermCount* end_ = nullptr;
+
+    WordFrequencies() = default;
+
+    WordFrequencies(const SearchServer* search_server, int ordinal);
+};
+
+class SearchServer::DocumentIdIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = int;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = int;
+
+    int operator*() const;
+
+    DocumentIdIterator& operator++();
+
+    bool operator==(const DocumentIdIterator& other) const;
+
+    bool operator!=(const DocumentIdIterator& other) const;
+
+private:
+    friend class SearchServer;
+
+    const SearchServer* search_server_;
+    // Живой номер или число выданных номеров у итератора за концом
+    int ordinal_;
+
+    DocumentIdIterator(const SearchServer* search_server, int ordinal);
+
+    void SkipRemoved();
+};
@@ -0,0 +1,245 @@
+#include "segmented_search_server.h"
+
+#include <numeric>
+
+SegmentedSearchServer::SegmentedSearchServer(const SearchServer& search_server, size_t segment_document_count)
+        : empty_server_(search_server.stop_words_),
+          segment_document_count_(segment_document_count),
+          active_segment_(std::make_unique<SearchServer>(empty_server_)),
+          document_ids_(search_server.begin(), search_server.end()) {
+    std::vector<Segment> segments;
+    if (search_server.GetDocumentCount() > 0) {
+        segments.push_back({std::make_shared<const SearchServer>(search_server),
+                            std::make_shared<const DeletedDocuments>()});
+    }
+    snapshot_ = MakeSnapshot(std::move(segments));
+    compaction_thread_ = std::thread([this] { RunCompaction(); });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer() {
+    {
+        std::lock_guard lock(compaction_mutex_);
+        stop_ = true;
+    }
+    compaction_cv_.notify_all();
+    compaction_thread_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                        const std::vector<int>& ratings) {
+    std::lock_guard guard(write_mutex_);
+    if (document_ids_.count(document_id) > 0) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+    active_segment_->AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+    if (static_cast<size_t>(active_segment_->GetDocumentCount()) >= segment_document_count_) {
+        FlushLocked();
+    }
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard guard(write_mutex_);
+    if (document_ids_.erase(document_id) == 0) {
+        return;
+    }
+    if (active_segment_->document_id_to_ordinal_.count(document_id) > 0) {
+        active_segment_->RemoveDocument(document_id);
+    } else {
+        pending_removals_.push_back(document_id);
+    }
+}
+
+void SegmentedSearchServer::Flush() {
+    std::lock_guard guard(write_mutex_);
+    FlushLocked();
+}
+
+void SegmentedSearchServer::WaitForCompaction() {
+    std::unique_lock lock(compaction_mutex_);
+    compaction_done_cv_.wait(lock, [this] { return !is_merging_ && !NeedsCompaction(); });
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const {
+    return GetSnapshot()->segments.size();
+}
+
+int SegmentedSearchServer::GetDocumentCount() const {
+    return GetSnapshot()->document_count;
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                              size_t top_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, top_count);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::execution::sequenced_policy&,
+                                                              std::string_view raw_query, DocumentStatus status,
+                                                              size_t top_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, [status]([[maybe_unused]] int document_id,
+                                                                     DocumentStatus document_status,
+                                                                     [[maybe_unused]] int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::execution::parallel_policy&,
+                                                              std::string_view raw_query, DocumentStatus status,
+                                                              size_t top_count) const {
+    return FindTopDocuments(std::execution::par, raw_query, [status]([[maybe_unused]] int document_id,
+                                                                     DocumentStatus document_status,
+                                                                     [[maybe_unused]] int rating) {
+        return document_status == status;
+    }, top_count);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SegmentedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    const auto snapshot = GetSnapshot();
+    for (const Segment& segment : snapshot->segments) {
+        if (!segment.HasDocument(document_id)) {
+            continue;
+        }
+        auto [words, status] = segment.server->MatchDocument(raw_query, document_id);
+        const auto query_words = SplitIntoWords(raw_query);
+        for (std::string_view& word : words) {
+            word = *std::find(query_words.begin(), query_words.end(), word);
+        }
+        return {words, status};
+    }
+    throw std::out_of_range("Document " + std::to_string(document_id) + " is not found");
+}
+
+bool SegmentedSearchServer::Segment::HasDocument(int document_id) const {
+    return server->document_id_to_ordinal_.count(document_id) > 0 && deleted->ids.count(document_id) == 0;
+}
+
+int SegmentedSearchServer::Segment::GetDocumentCount() const {
+    return server->GetDocumentCount() - static_cast<int>(deleted->ids.size());
+}
+
+int SegmentedSearchServer::Segment::GetDocumentFreq(std::string_view word) const {
+    const auto it = deleted->word_counts.find(word);
+    return server->GetDocumentFreq(word) - (it == deleted->word_counts.end() ? 0 : it->second);
+}
+
+std::shared_ptr<const SegmentedSearchServer::Snapshot> SegmentedSearchServer::GetSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::shared_ptr<const SegmentedSearchServer::Snapshot>
+SegmentedSearchServer::MakeSnapshot(std::vector<Segment> segments) {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->document_count = std::accumulate(segments.begin(), segments.end(), 0,
+                                               [](int count, const Segment& segment) {
+                                                   return count + segment.GetDocumentCount();
+                                               });
+    snapshot->segments = std::move(segments);
+    return snapshot;
+}
+
+std::shared_ptr<const SegmentedSearchServer::DeletedDocuments>
+SegmentedSearchServer::AddDeleted(const Segment& segment, const std::vector<int>& ids) {
+    auto deleted = std::make_shared<DeletedDocuments>(*segment.deleted);
+    for (const int document_id : ids) {
+        if (deleted->ids.insert(document_id).second) {
+            const SearchServer& server = *segment.server;
+            const int ordinal = server.document_id_to_ordinal_.at(document_id);
+            for (const auto& term_count : server.ordinal_to_term_counts_[ordinal]) {
+                ++deleted->word_counts[std::string(server.terms_.GetTerm(term_count.term_id))];
+            }
+        }
+    }
+    return deleted;
+}
+
+void SegmentedSearchServer::FlushLocked() {
+    if (active_segment_->GetDocumentCount() == 0 && pending_removals_.empty()) {
+        return;
+    }
+    {
+        std::lock_guard guard(publish_mutex_);
+        std::vector<Segment> segments = GetSnapshot()->segments;
+        // Отметки об удалении ставятся до добавления нового сегмента: документ с тем же id,
+        // добавленный после удаления, лежит в активном сегменте и не должен их получить
+        for (Segment& segment : segments) {
+            std::vector<int> removed_ids;
+            for (const int document_id : pending_removals_) {
+                if (segment.HasDocument(document_id)) {
+                    removed_ids.push_back(document_id);
+                }
+            }
+            if (!removed_ids.empty()) {
+                segment.deleted = AddDeleted(segment, removed_ids);
+            }
+        }
+        if (active_segment_->GetDocumentCount() > 0) {
+            segments.push_back({std::shared_ptr<const SearchServer>(std::move(active_segment_)),
+                                std::make_shared<const DeletedDocuments>()});
+            active_segment_ = std::make_unique<SearchServer>(empty_server_);
+        }
+        std::atomic_store(&snapshot_, MakeSnapshot(std::move(segments)));
+    }
+    pending_removals_.clear();
+    {
+        std::lock_guard lock(compaction_mutex_);
+    }
+    compaction_cv_.notify_one();
+}
+
+bool SegmentedSearchServer::NeedsCompaction() const {
+    return GetSnapshot()->segments.size() > MAX_SEGMENT_COUNT;
+}
+
+void SegmentedSearchServer::RunCompaction() {
+    std::unique_lock lock(compaction_mutex_);
+    while (true) {
+        compaction_cv_.wait(lock, [this] { return stop_ || NeedsCompaction(); });
+        if (stop_) {
+            return;
+        }
+        is_merging_ = true;
+        lock.unlock();
+        MergeSmallestSegments();
+        lock.lock();
+        is_merging_ = false;
+        compaction_done_cv_.notify_all();
+    }
+}
+
+void SegmentedSearchServer::MergeSmallestSegments() {
+    const auto start_snapshot = GetSnapshot();
+    std::vector<Segment> merged_segments = start_snapshot->segments;
+    std::sort(merged_segments.begin(), merged_segments.end(), [](const Segment& lhs, const Segment& rhs) {
+        return lhs.GetDocumentCount() < rhs.GetDocumentCount();
+    });
+    merged_segments.resize(std::min(SEGMENT_MERGE_FACTOR, merged_segments.size()));
+
+    // Слияние идёт без блокировок: сегменты неизменяемы, а удалённые документы пропускаются
+    auto merged_server = std::make_shared<SearchServer>(empty_server_);
+    for (const Segment& segment : merged_segments) {
+        merged_server->MergeDocuments(*segment.server, segment.deleted->ids);
+    }
+
+    std::lock_guard guard(publish_mutex_);
+    std::vector<Segment> segments;
+    // Документы, удалённые во время слияния, остаются в новом сегменте и получают отметки заново
+    std::vector<int> removed_during_merge;
+    for (const Segment& segment : GetSnapshot()->segments) {
+        const auto merged_it = std::find_if(merged_segments.begin(), merged_segments.end(),
+                                            [&segment](const Segment& merged) {
+                                                return merged.server == segment.server;
+                                            });
+        if (merged_it == merged_segments.end()) {
+            segments.push_back(segment);
+            continue;
+        }
+        std::set_difference(segment.deleted->ids.begin(), segment.deleted->ids.end(),
+                            merged_it->deleted->ids.begin(), merged_it->deleted->ids.end(),
+                            std::back_inserter(removed_during_merge));
+    }
+    Segment merged_segment{merged_server, std::make_shared<const DeletedDocuments>()};
+    merged_segment.deleted = AddDeleted(merged_segment, removed_during_merge);
+    segments.push_back(std::move(merged_segment));
+    std::atomic_store(&snapshot_, MakeSnapshot(std::move(segments)));
+}
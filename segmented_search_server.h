@@ -0,0 +1,182 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+constexpr size_t DEFAULT_SEGMENT_DOCUMENT_COUNT = 10'000;
+constexpr size_t MAX_SEGMENT_COUNT = 8;
+constexpr size_t SEGMENT_MERGE_FACTOR = 4;
+
+// Индекс для быстрой массовой загрузки, устроенный как LSM-дерево. Новые документы попадают
+// в маленький изменяемый сегмент, который после заполнения (или по Flush) замораживается
+// и публикуется. Опубликованные сегменты не меняются и ищутся вместе: IDF считается по всем сегментам,
+// поэтому релевантность совпадает с SearchServer, содержащим те же документы.
+// Удаление документа из опубликованного сегмента оставляет отметку, а сам документ вычищается, когда
+// фоновый поток сливает самые маленькие сегменты в один
+class SegmentedSearchServer {
+public:
+    // search_server задаёт стоп-слова, его документы становятся первым сегментом
+    explicit SegmentedSearchServer(const SearchServer& search_server,
+                                   size_t segment_document_count = DEFAULT_SEGMENT_DOCUMENT_COUNT);
+
+    SegmentedSearchServer(const SegmentedSearchServer&) = delete;
+    SegmentedSearchServer& operator=(const SegmentedSearchServer&) = delete;
+
+    ~SegmentedSearchServer();
+
+    // Изменения становятся видны поиску, когда сегмент заполнится, или после Flush
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    void Flush();
+
+    // Дожидается, пока фоновый поток сольёт лишние сегменты
+    void WaitForCompaction();
+
+    size_t GetSegmentCount() const;
+
+    int GetDocumentCount() const;
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_count);
+    }
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsInSegments(std::execution::seq, raw_query, document_predicate, top_count);
+    }
+
+    template<typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+                                           DocumentPredicate document_predicate,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const {
+        return FindTopDocumentsInSegments(std::execution::par, raw_query, document_predicate, top_count);
+    }
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const std::execution::sequenced_policy&, std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const std::execution::parallel_policy&, std::string_view raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Найденные слова ссылаются на raw_query: сегмент документа может быть слит и освобождён
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+private:
+    // Удалённые, но ещё не вычищенные документы сегмента и число таких документов с каждым словом
+    struct DeletedDocuments {
+        std::set<int> ids;
+        std::map<std::string, int, std::less<>> word_counts;
+    };
+
+    struct Segment {
+        std::shared_ptr<const SearchServer> server;
+        std::shared_ptr<const DeletedDocuments> deleted;
+
+        bool HasDocument(int document_id) const;
+
+        int GetDocumentCount() const;
+
+        int GetDocumentFreq(std::string_view word) const;
+    };
+
+    struct Snapshot {
+        std::vector<Segment> segments;
+        int document_count = 0;
+    };
+
+    // Пустой сервер с нужными стоп-словами: из его копий создаются новые сегменты
+    const SearchServer empty_server_;
+    const size_t segment_document_count_;
+
+    // Состояние писателя
+    std::mutex write_mutex_;
+    std::unique_ptr<SearchServer> active_segment_;
+    std::set<int> document_ids_;
+    std::vector<int> pending_removals_;
+
+    // Писатель и фоновый поток по очереди заменяют снимок под этим мьютексом.
+    // Снимок читается и заменяется только через std::atomic_load/std::atomic_store
+    std::mutex publish_mutex_;
+    std::shared_ptr<const Snapshot> snapshot_;
+
+    std::mutex compaction_mutex_;
+    std::condition_variable compaction_cv_;
+    std::condition_variable compaction_done_cv_;
+    bool is_merging_ = false;
+    bool stop_ = false;
+    std::thread compaction_thread_;
+
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+
+    static std::shared_ptr<const Snapshot> MakeSnapshot(std::vector<Segment> segments);
+
+    static std::shared_ptr<const DeletedDocuments> AddDeleted(const Segment& segment, const std::vector<int>& ids);
+
+    void FlushLocked();
+
+    bool NeedsCompaction() const;
+
+    void RunCompaction();
+
+    void MergeSmallestSegments();
+
+    template<typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsInSegments(ExecutionPolicy&& policy, std::string_view raw_query,
+                                                     DocumentPredicate document_predicate, size_t top_count) const {
+        const auto snapshot = GetSnapshot();
+        const auto query = empty_server_.ParseQuery(raw_query);
+
+        // IDF считается по всем сегментам без удалённых документов, как в едином индексе
+        std::map<std::string_view, double> inverse_document_freqs;
+        for (std::string_view word : query.plus_words) {
+            int document_freq = 0;
+            for (const Segment& segment : snapshot->segments) {
+                document_freq += segment.GetDocumentFreq(word);
+            }
+            inverse_document_freqs[word] = log(double(snapshot->document_count) / document_freq);
+        }
+
+        std::vector<std::vector<Document>> segment_documents(snapshot->segments.size());
+        std::transform(policy, snapshot->segments.begin(), snapshot->segments.end(), segment_documents.begin(),
+                       [&query, &document_predicate, &inverse_document_freqs](const Segment& segment) {
+                           const auto& deleted_ids = segment.deleted->ids;
+                           return segment.server->FindAllDocuments(
+                                   std::execution::seq, query,
+                                   [&document_predicate, &deleted_ids](int document_id, DocumentStatus status,
+                                                                       int rating) {
+                                       return deleted_ids.count(document_id) == 0
+                                              && document_predicate(document_id, status, rating);
+                                   },
+                                   [&inverse_document_freqs](std::string_view word, TermId) {
+                                       return inverse_document_freqs.at(word);
+                                   });
+                       });
+
+        std::vector<Document> matched_documents;
+        for (auto& documents : segment_documents) {
+            matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+        }
+        SelectTopDocuments(policy, matched_documents, top_count);
+        return matched_documents;
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <vector>
+
+// Вектор, первые N элементов которого лежат в самом объекте: пока элементов не больше N,
+// он не обращается к куче. Поддерживает только то, что нужно для коротких списков
+// тривиально копируемых значений
+template<typename T, size_t N>
+class SmallVector {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector supports only trivially copyable types");
+
+    void PushBack(const T& value) {
+        if (heap_.empty()) {
+            if (size_ < N) {
+                inline_[size_++] = value;
+                return;
+            }
+            heap_.reserve(2 * N);
+            heap_.assign(inline_.begin(), inline_.end());
+        }
+        heap_.push_back(value);
+        ++size_;
+    }
+
+    // Оставляет первые count элементов, count не больше размера
+    void Truncate(size_t count) {
+        size_ = count;
+        if (!heap_.empty()) {
+            heap_.resize(size_);
+            if (heap_.empty()) {
+                heap_ = {};
+            }
+        }
+    }
+
+    T* begin() {
+        return heap_.empty() ? inline_.data() : heap_.data();
+    }
+
+    T* end() {
+        return begin() + size_;
+    }
+
+    const T* begin() const {
+        return heap_.empty() ? inline_.data() : heap_.data();
+    }
+
+    const T* end() const {
+        return begin() + size_;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    bool IsEmpty() const {
+        return size_ == 0;
+    }
+
+private:
+    std::array<T, N> inline_{};
+    std::vector<T> heap_;
+    size_t size_ = 0;
+};
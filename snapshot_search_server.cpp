@@ -0,0 +1,79 @@
+#include "snapshot_search_server.h"
+
+#include <algorithm>
+
+SnapshotSearchServer::SnapshotSearchServer(const SearchServer& search_server)
+        : published_server_(std::make_unique<SearchServer>(search_server)),
+          pending_server_(std::make_unique<SearchServer>(search_server)),
+          snapshot_(MakeSnapshot(*published_server_)) {
+}
+
+std::shared_ptr<const SearchServer> SnapshotSearchServer::GetSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+SnapshotSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    auto [words, status] = GetSnapshot()->MatchDocument(raw_query, document_id);
+    PointIntoQuery(words, raw_query);
+    return {words, status};
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                       const std::vector<int>& ratings) {
+    std::lock_guard guard(write_mutex_);
+    pending_server_->AddDocument(document_id, document, status, ratings);
+    pending_changes_.push_back([document_id, document = std::string(document), status, ratings]
+                                       (SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id) {
+    std::lock_guard guard(write_mutex_);
+    pending_server_->RemoveDocument(document_id);
+    pending_changes_.push_back([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+    });
+}
+
+void SnapshotSearchServer::Publish() {
+    std::lock_guard guard(write_mutex_);
+    if (pending_changes_.empty()) {
+        return;
+    }
+    {
+        std::lock_guard lock(release_mutex_);
+        released_ = false;
+    }
+    std::atomic_store(&snapshot_, MakeSnapshot(*pending_server_));
+    std::swap(published_server_, pending_server_);
+    {
+        // Удалитель старого снимка срабатывает, когда его отпускает последний читатель
+        std::unique_lock lock(release_mutex_);
+        release_cv_.wait(lock, [this] { return released_; });
+    }
+    for (const auto& change : pending_changes_) {
+        change(*pending_server_);
+    }
+    pending_changes_.clear();
+}
+
+std::shared_ptr<const SearchServer> SnapshotSearchServer::MakeSnapshot(const SearchServer& server) {
+    return std::shared_ptr<const SearchServer>(&server, [this](const SearchServer*) {
+        std::lock_guard lock(release_mutex_);
+        released_ = true;
+        release_cv_.notify_all();
+    });
+}
+
+void SnapshotSearchServer::PointIntoQuery(std::vector<std::string_view>& words, std::string_view raw_query) {
+    if (words.empty()) {
+        return;
+    }
+    // Найденные слова — плюс-слова запроса, поэтому каждое встречается среди слов запроса как есть
+    const auto query_words = SplitIntoWords(raw_query);
+    for (std::string_view& word : words) {
+        word = *std::find(query_words.begin(), query_words.end(), word);
+    }
+}
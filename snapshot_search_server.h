@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "search_server.h"
+
+// Индекс, который читают из многих потоков, пока другой поток его изменяет.
+// Хранятся две копии SearchServer: читатели работают с опубликованной, а писатель меняет вторую
+// и запоминает свои изменения. Publish меняет копии местами, дожидается, пока читатели отпустят
+// старую копию, и повторяет на ней накопленные изменения. Поэтому запись никогда не ждёт копирования
+// всего индекса, а читатели не ждут писателя
+class SnapshotSearchServer {
+public:
+    explicit SnapshotSearchServer(const SearchServer& search_server);
+
+    SnapshotSearchServer(const SnapshotSearchServer&) = delete;
+    SnapshotSearchServer& operator=(const SnapshotSearchServer&) = delete;
+
+    // Неизменяемый снимок индекса. Пока снимок жив, Publish ждёт его освобождения,
+    // поэтому долго держать его не стоит. Снимки не должны переживать сам SnapshotSearchServer
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+    template<typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const {
+        return GetSnapshot()->FindTopDocuments(std::forward<Args>(args)...);
+    }
+
+    // Слова результата ссылаются на raw_query, а не на словарь копии индекса: Publish повторяет удаления
+    // на старой копии и может убрать из её словаря опустевшие слова, пока результат ещё используется.
+    // Поэтому результат действителен, пока жива строка запроса
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(std::string_view raw_query, int document_id) const;
+
+    template<typename ExecutionPolicy>
+    std::tuple<std::vector<std::string_view>, DocumentStatus>
+    MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const {
+        auto [words, status] = GetSnapshot()->MatchDocument(policy, raw_query, document_id);
+        PointIntoQuery(words, raw_query);
+        return {words, status};
+    }
+
+    // Изменения становятся видны читателям после Publish. Ошибки выбрасываются сразу, как у SearchServer
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    void Publish();
+
+private:
+    std::unique_ptr<SearchServer> published_server_;
+    std::unique_ptr<SearchServer> pending_server_;
+    std::vector<std::function<void(SearchServer&)>> pending_changes_;
+    std::mutex write_mutex_;
+
+    std::mutex release_mutex_;
+    std::condition_variable release_cv_;
+    bool released_ = false;
+
+    // Читается и заменяется только через std::atomic_load/std::atomic_store
+    std::shared_ptr<const SearchServer> snapshot_;
+
+    std::shared_ptr<const SearchServer> MakeSnapshot(const SearchServer& server);
+
+    // Заменяет каждое слово равным ему словом запроса
+    static void PointIntoQuery(std::vector<std::string_view>& words, std::string_view raw_query);
+};
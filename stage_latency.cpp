@@ -0,0 +1,140 @@
+#include "stage_latency.h"
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+constexpr std::array<double, 4> DUMPED_QUANTILES = {0.5, 0.9, 0.99, 1.0};
+
+constexpr std::array<std::string_view, DUMPED_QUANTILES.size()> DUMPED_QUANTILE_NAMES = {"p50", "p90", "p99", "max"};
+
+class ThreadStageLatencies;
+
+// Гистограммы живых потоков и сумма гистограмм завершившихся
+struct StageLatencyRegistry {
+    std::mutex mutex;
+    std::vector<ThreadStageLatencies*> threads;
+    StageLatencies retired;
+};
+
+StageLatencyRegistry& GetRegistry() {
+    // Реестр не разрушается, чтобы потоки могли завершаться после выхода из main
+    static auto* registry = new StageLatencyRegistry;
+    return *registry;
+}
+
+// Мьютекс потока почти всегда свободен: его берёт ещё только сборка гистограмм
+class ThreadStageLatencies {
+public:
+    ThreadStageLatencies() {
+        StageLatencyRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.threads.push_back(this);
+    }
+
+    ~ThreadStageLatencies() {
+        StageLatencyRegistry& registry = GetRegistry();
+        std::lock_guard guard(registry.mutex);
+        MergeTo(registry.retired);
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+    }
+
+    void Record(SearchStage stage, uint64_t nanoseconds) {
+        std::lock_guard guard(mutex_);
+        latencies_[static_cast<size_t>(stage)].Add(nanoseconds);
+    }
+
+    void MergeTo(StageLatencies& latencies) const {
+        std::lock_guard guard(mutex_);
+        for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+            latencies[stage].Merge(latencies_[stage]);
+        }
+    }
+
+    void Reset() {
+        std::lock_guard guard(mutex_);
+        latencies_ = {};
+    }
+
+private:
+    mutable std::mutex mutex_;
+    StageLatencies latencies_;
+};
+
+}  // namespace
+
+std::string_view GetStageName(SearchStage stage) {
+    switch (stage) {
+        case SearchStage::PARSE:
+            return "parse";
+        case SearchStage::MINUS_EXCLUSION:
+            return "minus_exclusion";
+        case SearchStage::POSTING_TRAVERSAL:
+            return "posting_traversal";
+        case SearchStage::TOP_K:
+            return "top_k";
+        case SearchStage::RESULT_COPY:
+            return "result_copy";
+    }
+    return "unknown";
+}
+
+void RecordStageLatency(SearchStage stage, std::chrono::steady_clock::duration duration) {
+    thread_local ThreadStageLatencies thread_latencies;
+    thread_latencies.Record(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+StageLatencies GetStageLatencies() {
+    StageLatencyRegistry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    StageLatencies latencies = registry.retired;
+    for (const ThreadStageLatencies* thread_latencies : registry.threads) {
+        thread_latencies->MergeTo(latencies);
+    }
+    return latencies;
+}
+
+void ResetStageLatencies() {
+    StageLatencyRegistry& registry = GetRegistry();
+    std::lock_guard guard(registry.mutex);
+    registry.retired = {};
+    for (ThreadStageLatencies* thread_latencies : registry.threads) {
+        thread_latencies->Reset();
+    }
+}
+
+std::string DumpStageLatenciesText() {
+    const StageLatencies latencies = GetStageLatencies();
+    std::ostringstream out;
+    for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+        out << GetStageName(static_cast<SearchStage>(stage)) << ": count " << latencies[stage].GetCount();
+        for (size_t i = 0; i < DUMPED_QUANTILES.size(); ++i) {
+            out << ", " << DUMPED_QUANTILE_NAMES[i] << ' ' << latencies[stage].GetPercentile(DUMPED_QUANTILES[i])
+                << " ns";
+        }
+        out << '\n';
+    }
+    return out.str();
+}
+
+std::string DumpStageLatenciesJson() {
+    const StageLatencies latencies = GetStageLatencies();
+    std::ostringstream out;
+    out << '{';
+    for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+        if (stage > 0) {
+            out << ',';
+        }
+        out << '"' << GetStageName(static_cast<SearchStage>(stage)) << "\":{\"count\":"
+            << latencies[stage].GetCount();
+        for (size_t i = 0; i < DUMPED_QUANTILES.size(); ++i) {
+            out << ",\"" << DUMPED_QUANTILE_NAMES[i] << "_ns\":" << latencies[stage].GetPercentile(DUMPED_QUANTILES[i]);
+        }
+        out << '}';
+    }
+    out << '}';
+    return out.str();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "latency_histogram.h"
+
+// Стадии поиска, задержки которых собираются в гистограммы
+enum class SearchStage {
+    PARSE,
+    MINUS_EXCLUSION,
+    // Обход постингов вместе с проверкой предиката: проверка встроена в обход и отдельно
+    // не измеряется, замер каждого вызова стоил бы дороже самого предиката
+    POSTING_TRAVERSAL,
+    TOP_K,
+    RESULT_COPY,
+};
+
+constexpr size_t SEARCH_STAGE_COUNT = 5;
+
+using StageLatencies = std::array<LatencyHistogram, SEARCH_STAGE_COUNT>;
+
+std::string_view GetStageName(SearchStage stage);
+
+// Каждый поток пишет в свои гистограммы, поэтому запись не конкурирует с другими потоками
+void RecordStageLatency(SearchStage stage, std::chrono::steady_clock::duration duration);
+
+// Сумма гистограмм всех потоков, включая завершившиеся
+StageLatencies GetStageLatencies();
+
+void ResetStageLatencies();
+
+// Число замеров и перцентили каждой стадии в наносекундах
+std::string DumpStageLatenciesText();
+
+std::string DumpStageLatenciesJson();
+
+// Записывает время жизни объекта в гистограмму стадии
+class StageTimer {
+public:
+    explicit StageTimer(SearchStage stage) : stage_(stage) {
+    }
+
+    StageTimer(const StageTimer&) = delete;
+
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer() {
+        RecordStageLatency(stage_, std::chrono::steady_clock::now() - start_time_);
+    }
+
+private:
+    const SearchStage stage_;
+    const std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+};
+
+// Замеры включаются флагом компиляции SEARCH_SERVER_METRICS, без него макрос ничего не делает
+#define STAGE_TIMER_CONCAT_INTERNAL(X, Y) X##Y
+#define STAGE_TIMER_CONCAT(X, Y) STAGE_TIMER_CONCAT_INTERNAL(X, Y)
+#ifdef SEARCH_SERVER_METRICS
+#define MEASURE_STAGE(stage) StageTimer STAGE_TIMER_CONCAT(stage_timer, __LINE__)(SearchStage::stage)
+#else
+#define MEASURE_STAGE(stage)
+#endif
@@ -1,16 +1,132 @@
 #include "string_processing.h"
 
-std::vector<std::string_view> SplitIntoWords(std::string_view text) {
-    std::string_view str = text;
-    std::vector<std::string_view> words;
-    while (true) {
-        size_t space = str.find(' ');
-        words.push_back(str.substr(0, space));
-        if (space == str.npos) {
-            break;
-        } else {
-            str.remove_prefix(space + 1);
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_SERVER_X86_TOKENIZER
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t NO_INVALID_BYTE = std::string_view::npos;
+
+// Текст разбирается с позиции position до конца по одному байту
+void TokenizeScalar(std::string_view text, size_t position, size_t& word_begin, size_t& first_invalid_byte,
+                    std::vector<std::string_view>& words) {
+    for (; position < text.size(); ++position) {
+        const char c = text[position];
+        if (c == ' ') {
+            words.push_back(text.substr(word_begin, position - word_begin));
+            word_begin = position + 1;
+        } else if (c >= '\0' && c < ' ' && first_invalid_byte == NO_INVALID_BYTE) {
+            first_invalid_byte = position;
+        }
+    }
+}
+
+#ifdef SEARCH_SERVER_X86_TOKENIZER
+
+// Каждый установленный бит spaces — пробел в блоке, который начинается с позиции block_begin
+void AddWords(std::string_view text, size_t block_begin, uint32_t spaces, size_t& word_begin,
+              std::vector<std::string_view>& words) {
+    while (spaces != 0) {
+        const size_t position = block_begin + __builtin_ctz(spaces);
+        words.push_back(text.substr(word_begin, position - word_begin));
+        word_begin = position + 1;
+        spaces &= spaces - 1;
+    }
+}
+
+size_t TokenizeSse2(std::string_view text, size_t& word_begin, size_t& first_invalid_byte,
+                    std::vector<std::string_view>& words) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(' ' - 1);
+    size_t position = 0;
+    for (; position + 16 <= text.size(); position += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + position));
+        if (first_invalid_byte == NO_INVALID_BYTE) {
+            // Байт меньше пробела без знака, если он не меняется при min с 0x1F
+            const auto invalid = static_cast<uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(block, last_control), block)));
+            if (invalid != 0) {
+                first_invalid_byte = position + __builtin_ctz(invalid);
+            }
+        }
+        AddWords(text, position, static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, space))), word_begin,
+                 words);
+    }
+    return position;
+}
+
+__attribute__((target("avx2")))
+size_t TokenizeAvx2(std::string_view text, size_t& word_begin, size_t& first_invalid_byte,
+                    std::vector<std::string_view>& words) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(' ' - 1);
+    size_t position = 0;
+    for (; position + 32 <= text.size(); position += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + position));
+        if (first_invalid_byte == NO_INVALID_BYTE) {
+            const auto invalid = static_cast<uint32_t>(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(block, last_control), block)));
+            if (invalid != 0) {
+                first_invalid_byte = position + __builtin_ctz(invalid);
+            }
         }
+        AddWords(text, position, static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, space))),
+                 word_begin, words);
+    }
+    return position;
+}
+
+#endif
+
+// Разбирает столько целых блоков, сколько умеет, и возвращает позицию, с которой продолжить побайтно
+using BlockTokenizer = size_t (*)(std::string_view text, size_t& word_begin, size_t& first_invalid_byte,
+                                  std::vector<std::string_view>& words);
+
+BlockTokenizer ChooseBlockTokenizer() {
+#ifdef SEARCH_SERVER_X86_TOKENIZER
+    if (__builtin_cpu_supports("avx2")) {
+        return TokenizeAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return TokenizeSse2;
+    }
+#endif
+    return nullptr;
+}
+
+}  // namespace
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    return Tokenize(text).words;
+}
+
+TokenizedText Tokenize(std::string_view text) {
+    static const BlockTokenizer block_tokenizer = ChooseBlockTokenizer();
+
+    TokenizedText result;
+    // Запас на слова длиной от трёх букв: на коротких документах перевыделения вектора обходятся
+    // дороже самого разбора
+    result.words.reserve(text.size() / 4 + 1);
+    size_t word_begin = 0;
+    size_t first_invalid_byte = NO_INVALID_BYTE;
+    const size_t position = block_tokenizer != nullptr
+                            ? block_tokenizer(text, word_begin, first_invalid_byte, result.words) : 0;
+    TokenizeScalar(text, position, word_begin, first_invalid_byte, result.words);
+    result.words.push_back(text.substr(word_begin));
+
+    result.first_invalid_word = result.words.size();
+    if (first_invalid_byte != NO_INVALID_BYTE) {
+        // Слова идут в тексте по порядку, нужное — последнее, начавшееся не позже управляющего символа
+        const char* invalid_byte = text.data() + first_invalid_byte;
+        const auto it = std::upper_bound(result.words.begin(), result.words.end(), invalid_byte,
+                                         [](const char* byte, std::string_view word) {
+                                             return byte < word.data();
+                                         });
+        result.first_invalid_word = std::prev(it) - result.words.begin();
     }
-    return words;
-}
\ No newline at end of file
+    return result;
+}
@@ -4,13 +4,24 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
+struct TokenizedText {
+    std::vector<std::string_view> words;
+    // Номер первого слова с управляющим символом (байты 0x00-0x1F) или words.size(), если таких нет
+    size_t first_invalid_word = 0;
+};
+
+// Разбивает текст по пробелам так же, как SplitIntoWords, и за тот же проход ищет управляющие символы.
+// На x86 текст просматривается блоками по 32 (AVX2) или 16 (SSE2) байт, набор инструкций
+// выбирается при первом вызове по возможностям процессора
+TokenizedText Tokenize(std::string_view text);
+
 template<typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const auto& str : strings) {
         if (str.size()>0) {
             non_empty_strings.insert(std::string(str));
         }
     }
     return non_empty_strings;
-}
\ No newline at end of file
+}
@@ -0,0 +1,70 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <utility>
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+    term_to_id_.reserve(other.id_to_term_.size());
+    id_to_term_.reserve(other.id_to_term_.size());
+    for (std::string_view term : other.id_to_term_) {
+        Intern(term);
+    }
+}
+
+TermDictionary::TermDictionary(TermDictionary&& other) noexcept
+        : blocks_(std::move(other.blocks_)),
+          current_block_(std::exchange(other.current_block_, nullptr)),
+          block_free_(std::exchange(other.block_free_, 0)),
+          term_to_id_(std::move(other.term_to_id_)),
+          id_to_term_(std::move(other.id_to_term_)) {
+}
+
+TermDictionary& TermDictionary::operator=(TermDictionary other) noexcept {
+    std::swap(blocks_, other.blocks_);
+    std::swap(current_block_, other.current_block_);
+    std::swap(block_free_, other.block_free_);
+    std::swap(term_to_id_, other.term_to_id_);
+    std::swap(id_to_term_, other.id_to_term_);
+    return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view term) {
+    if (const auto it = term_to_id_.find(term); it != term_to_id_.end()) {
+        return it->second;
+    }
+    const std::string_view stored = Store(term);
+    const TermId term_id = static_cast<TermId>(id_to_term_.size());
+    id_to_term_.push_back(stored);
+    term_to_id_.emplace(stored, term_id);
+    return term_id;
+}
+
+TermId TermDictionary::Find(std::string_view term) const {
+    const auto it = term_to_id_.find(term);
+    return it == term_to_id_.end() ? NO_TERM : it->second;
+}
+
+std::string_view TermDictionary::GetTerm(TermId term_id) const {
+    return id_to_term_[term_id];
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return id_to_term_.size();
+}
+
+std::string_view TermDictionary::Store(std::string_view term) {
+    char* data;
+    if (term.size() > BLOCK_SIZE / 4) {
+        // Длинное слово получает отдельный блок, чтобы не бросать недозаполненным текущий
+        data = blocks_.emplace_back(std::make_unique<char[]>(term.size())).get();
+    } else {
+        if (term.size() > block_free_) {
+            current_block_ = blocks_.emplace_back(std::make_unique<char[]>(BLOCK_SIZE)).get();
+            block_free_ = BLOCK_SIZE;
+        }
+        data = current_block_ + (BLOCK_SIZE - block_free_);
+        block_free_ -= term.size();
+    }
+    std::copy(term.begin(), term.end(), data);
+    return {data, term.size()};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = int;
+
+constexpr TermId NO_TERM = -1;
+
+// Словарь слов: каждое различное слово хранится один раз и получает плотный номер (TermId).
+// Символы слов складываются в общие блоки памяти, которые никогда не перемещаются,
+// поэтому string_view, возвращаемые словарём, действительны всё время его жизни
+class TermDictionary {
+public:
+    TermDictionary() = default;
+
+    // Копия заново складывает слова в свои блоки, номера слов при этом сохраняются
+    TermDictionary(const TermDictionary& other);
+
+    TermDictionary(TermDictionary&& other) noexcept;
+
+    TermDictionary& operator=(TermDictionary other) noexcept;
+
+    // Возвращает номер слова, добавляя слово в словарь при первом обращении
+    TermId Intern(std::string_view term);
+
+    // Возвращает номер слова или NO_TERM, если слова в словаре нет
+    TermId Find(std::string_view term) const;
+
+    std::string_view GetTerm(TermId term_id) const;
+
+    size_t GetTermCount() const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_block_ = nullptr;
+    size_t block_free_ = 0;
+    std::unordered_map<std::string_view, TermId> term_to_id_;
+    std::vector<std::string_view> id_to_term_;
+
+    std::string_view Store(std::string_view term);
+};
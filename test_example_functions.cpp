@@ -1,5 +1,11 @@
 #include "test_example_functions.h"
 
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
 using namespace std::string_literals;
 
 
@@ -63,6 +69,25 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
     }
 }
 
+void AssertSameDocuments(const std::vector<Document>& result, const std::vector<Document>& expected,
+                         const std::string& hint, bool compare_ids) {
+    ASSERT_EQUAL_HINT(result.size(), expected.size(), hint);
+    for (size_t i = 0; i < result.size(); ++i) {
+        if (compare_ids) {
+            ASSERT_EQUAL_HINT(result[i].id, expected[i].id, hint);
+        }
+        ASSERT_EQUAL_HINT(result[i].relevance, expected[i].relevance, hint);
+        ASSERT_EQUAL_HINT(result[i].rating, expected[i].rating, hint);
+    }
+}
+
+void AssertSameTopDocuments(const SearchServer& search_server, const SearchServer& expected_server,
+                            const std::vector<std::string>& queries) {
+    for (const std::string& query : queries) {
+        AssertSameDocuments(search_server.FindTopDocuments(query), expected_server.FindTopDocuments(query), query);
+    }
+}
+
 void TestProcessQueries() {
     SearchServer search_server("and with"s);
 
@@ -176,11 +201,900 @@ void TestMatchDocument() {
         std::cout << words.size() << " words for document 3"s << std::endl;
         // 0 words for document 3
     }
+
+    // Прочие политики и изменяемый объект политики попадают в одну из двух версий
+    {
+        auto policy = std::execution::par;
+        const auto expected = search_server.MatchDocument(std::execution::seq, query, 2);
+        ASSERT(search_server.MatchDocument(std::execution::par_unseq, query, 2) == expected);
+        ASSERT(search_server.MatchDocument(policy, query, 2) == expected);
+    }
 }
 /*1 words for document 1
 2 words for document 2
 0 words for document 3*/
 
+void TestParallelFindTopDocuments() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s};
+    SearchServer search_server("and with"s);
+    std::mt19937 generator;
+    // Документов больше, чем номеров в одном отрезке параллельного поиска, а удаления оставляют в номерах пропуски
+    for (int id = 0; id < 10'000; ++id) {
+        std::string document;
+        for (int i = 0; i < 10; ++i) {
+            document += words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+        }
+        search_server.AddDocument(id, document, static_cast<DocumentStatus>(id % 4), {id % 7, id % 3});
+    }
+    for (int id = 4000; id < 4500; ++id) {
+        search_server.RemoveDocument(id);
+    }
+
+    const std::vector<std::string> queries = {"cat dog"s, "funny nasty -rat"s, "curly hair pet -dog -cat"s, "rat"s};
+    for (const std::string& query : queries) {
+        for (DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            AssertSameDocuments(search_server.FindTopDocuments(std::execution::par, query, status),
+                                search_server.FindTopDocuments(std::execution::seq, query, status), query);
+        }
+    }
+    std::cout << "Parallel FindTopDocuments matches sequential"s << std::endl;
+}
+/*Parallel FindTopDocuments matches sequential*/
+
+void TestSelectTopDocuments() {
+    std::mt19937 generator;
+    std::vector<Document> documents;
+    for (int id = 0; id < 50'000; ++id) {
+        // Релевантность и рейтинг берутся из маленьких диапазонов, чтобы было много равных значений
+        documents.emplace_back(id, std::uniform_int_distribution(0, 100)(generator) / 100.0,
+                               std::uniform_int_distribution(0, 5)(generator));
+    }
+    auto expected = documents;
+    std::sort(expected.begin(), expected.end(), IsMoreRelevant);
+
+    for (size_t top_count : {size_t(0), size_t(1), size_t(5), size_t(100), documents.size() + 1}) {
+        auto seq_result = documents;
+        SelectTopDocuments(std::execution::seq, seq_result, top_count);
+        auto par_result = documents;
+        SelectTopDocuments(std::execution::par, par_result, top_count);
+
+        const size_t expected_size = std::min(top_count, documents.size());
+        ASSERT_EQUAL(seq_result.size(), expected_size);
+        ASSERT_EQUAL(par_result.size(), expected_size);
+        for (size_t i = 0; i < expected_size; ++i) {
+            ASSERT_EQUAL(seq_result[i].relevance, expected[i].relevance);
+            ASSERT_EQUAL(seq_result[i].rating, expected[i].rating);
+            ASSERT_EQUAL(par_result[i].relevance, expected[i].relevance);
+            ASSERT_EQUAL(par_result[i].rating, expected[i].rating);
+        }
+    }
+
+    SearchServer search_server("and with"s);
+    for (int id = 1; id <= 10; ++id) {
+        search_server.AddDocument(id, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {id});
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments("rat"s).size(), size_t(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT_EQUAL(search_server.FindTopDocuments("rat"s, DocumentStatus::ACTUAL, 8).size(), 8u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(std::execution::par, "rat"s, DocumentStatus::ACTUAL, 20).size(), 10u);
+    std::cout << "Top-K selection matches full sort"s << std::endl;
+}
+/*Top-K selection matches full sort*/
+
+void TestTermDictionary() {
+    TermDictionary terms;
+    const TermId cat = terms.Intern("cat"s);
+    const std::string_view stored_cat = terms.GetTerm(cat);
+    ASSERT_EQUAL(terms.Intern("cat"s), cat);
+    ASSERT_EQUAL(terms.Find("cat"s), cat);
+    ASSERT_EQUAL(terms.Find("dog"s), NO_TERM);
+
+    // Слова занимают несколько блоков, а одно слово не помещается в блок целиком
+    for (int i = 0; i < 100'000; ++i) {
+        terms.Intern("word"s + std::to_string(i));
+    }
+    const std::string long_word(100'000, 'x');
+    const TermId long_id = terms.Intern(long_word);
+    ASSERT_EQUAL(terms.GetTermCount(), 100'002u);
+    ASSERT_EQUAL(terms.GetTerm(long_id), long_word);
+    ASSERT_EQUAL(terms.GetTerm(cat).data(), stored_cat.data());
+    ASSERT_EQUAL(terms.GetTerm(terms.Find("word99999"s)), "word99999"s);
+
+    const TermDictionary copy = terms;
+    ASSERT_EQUAL(copy.Find("word12345"s), terms.Find("word12345"s));
+    ASSERT(copy.GetTerm(cat).data() != stored_cat.data());
+    std::cout << "TermDictionary interns words"s << std::endl;
+}
+/*TermDictionary interns words*/
+
+void TestRemoveDocumentKeepsIndexConsistent() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "unique words only"s, DocumentStatus::ACTUAL, {1, 2});
+
+    search_server.RemoveDocument(std::execution::par, 3);
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(1);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+    ASSERT_EQUAL(search_server.GetDocumentId(0), 2);
+    ASSERT(search_server.FindTopDocuments("unique rat"s).empty());
+    ASSERT(search_server.GetWordFrequencies(3).empty());
+
+    // Удалённые id и слова можно добавить снова, результат не отличается от нового сервера
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "unique words only"s, DocumentStatus::ACTUAL, {1, 2});
+    SearchServer fresh_server("and with"s);
+    fresh_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    fresh_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    fresh_server.AddDocument(3, "unique words only"s, DocumentStatus::ACTUAL, {1, 2});
+    AssertSameTopDocuments(search_server, fresh_server, {"funny rat"s, "unique pet -hair"s, "curly"s});
+
+    // Порядок документов — порядок добавления, GetDocumentId с ним согласован
+    SearchServer ordered_server(""s);
+    std::vector<int> expected_ids;
+    for (int i = 0; i < 3000; ++i) {
+        const int document_id = (i * 7919) % 3001;
+        // Каждое слово word* встречается в одном документе, после удаления документа оно пустеет
+        ordered_server.AddDocument(document_id, "common word"s + std::to_string(document_id), DocumentStatus::ACTUAL,
+                                   {i % 7});
+        expected_ids.push_back(document_id);
+    }
+    const int first_removed_id = expected_ids.front();
+    for (int i = 0; i < 2500; ++i) {
+        ordered_server.RemoveDocument(expected_ids[i * 3 % expected_ids.size()]);
+        expected_ids.erase(expected_ids.begin() + i * 3 % expected_ids.size());
+        if (i % 500 == 0) {
+            ASSERT(std::vector<int>(ordered_server.begin(), ordered_server.end()) == expected_ids);
+        }
+    }
+    ASSERT(std::vector<int>(ordered_server.begin(), ordered_server.end()) == expected_ids);
+    ASSERT_EQUAL(ordered_server.GetDocumentCount(), static_cast<int>(expected_ids.size()));
+    for (size_t index = 0; index < expected_ids.size(); ++index) {
+        ASSERT_EQUAL(ordered_server.GetDocumentId(static_cast<int>(index)), expected_ids[index]);
+    }
+    // Пустые слова к этому моменту убраны из словаря, оставшиеся ищутся как раньше
+    SearchServer expected_server(""s);
+    for (const int document_id : expected_ids) {
+        expected_server.AddDocument(document_id, "common word"s + std::to_string(document_id),
+                                    DocumentStatus::ACTUAL, {0});
+    }
+    for (const int document_id : {expected_ids.front(), expected_ids.back()}) {
+        const std::string query = "word"s + std::to_string(document_id);
+        const auto result = ordered_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(result.size(), 1u, query);
+        ASSERT_EQUAL_HINT(result[0].id, document_id, query);
+        ASSERT_EQUAL_HINT(result[0].relevance, expected_server.FindTopDocuments(query)[0].relevance, query);
+        ASSERT_EQUAL(ordered_server.GetWordFrequencies(document_id).GetFrequency(query), 0.5);
+        const auto[words, status] = ordered_server.MatchDocument("common "s + query, document_id);
+        ASSERT_EQUAL(words.size(), 2u);
+        ASSERT_EQUAL(words[0], "common"s);
+        ASSERT_EQUAL(words[1], query);
+    }
+    ASSERT(ordered_server.FindTopDocuments("word"s + std::to_string(first_removed_id)).empty());
+    ordered_server.AddDocument(5000, "common word5000"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(ordered_server.GetDocumentId(ordered_server.GetDocumentCount() - 1), 5000);
+    ASSERT_EQUAL(ordered_server.FindTopDocuments("word5000"s).size(), 1u);
+    std::cout << "RemoveDocument keeps index consistent"s << std::endl;
+}
+/*RemoveDocument keeps index consistent*/
+
+void TestRemovedOrdinalsAreCompacted() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s};
+    const std::vector<DocumentStatus> statuses = {DocumentStatus::ACTUAL, DocumentStatus::BANNED,
+                                                  DocumentStatus::IRRELEVANT};
+    const auto make_text = [&words](int document_id) {
+        return words[document_id % words.size()] + " "s + words[document_id / 3 % words.size()] + " "s
+               + words[document_id / 7 % words.size()];
+    };
+    // Удалённых номеров становится больше живых, после чего живые документы перенумеровываются
+    SearchServer search_server(""s);
+    std::vector<int> removed_ids;
+    for (int document_id = 0; document_id < 3000; ++document_id) {
+        search_server.AddDocument(document_id, make_text(document_id), statuses[document_id % statuses.size()],
+                                  {document_id % 11});
+        if (document_id % 4 != 0) {
+            removed_ids.push_back(document_id);
+        }
+    }
+    search_server.RemoveDocuments(std::execution::par, removed_ids);
+    for (int document_id = 3000; document_id < 3100; ++document_id) {
+        search_server.AddDocument(document_id, make_text(document_id), statuses[document_id % statuses.size()],
+                                  {document_id % 11});
+        search_server.RemoveDocument(document_id - 3000 + 4);
+    }
+
+    SearchServer expected_server(""s);
+    for (const int document_id : search_server) {
+        expected_server.AddDocument(document_id, make_text(document_id), statuses[document_id % statuses.size()],
+                                    {document_id % 11});
+    }
+    ASSERT_EQUAL(search_server.GetDocumentCount(), expected_server.GetDocumentCount());
+    for (int index = 0; index < search_server.GetDocumentCount(); ++index) {
+        ASSERT_EQUAL(search_server.GetDocumentId(index), expected_server.GetDocumentId(index));
+    }
+    for (const std::string& query : {"cat dog"s, "funny -rat"s, "curly hair pet"s}) {
+        for (const DocumentStatus status : statuses) {
+            AssertSameDocuments(search_server.FindTopDocuments(std::execution::par, query, status, 50),
+                                expected_server.FindTopDocuments(std::execution::par, query, status, 50), query);
+        }
+    }
+    const auto[words_3004, status_3004] = search_server.MatchDocument("cat dog rat pet funny"s, 3004);
+    const auto[expected_words, expected_status] = expected_server.MatchDocument("cat dog rat pet funny"s, 3004);
+    ASSERT(words_3004 == expected_words);
+    ASSERT(status_3004 == expected_status);
+    std::cout << "Removed ordinals are compacted"s << std::endl;
+}
+/*Removed ordinals are compacted*/
+
+void TestConcurrentMatchDocument() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s,
+                                            "very"s, "not"s, "big"s, "small"s};
+    std::mt19937 generator;
+    const auto random_word = [&generator, &words] {
+        return words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+    };
+
+    SearchServer search_server("and with"s);
+    for (int id = 0; id < 100; ++id) {
+        std::string document;
+        for (int i = 0; i < 6; ++i) {
+            document += random_word() + " "s;
+        }
+        search_server.AddDocument(id, document, DocumentStatus::ACTUAL, {1});
+    }
+
+    struct Call {
+        std::string query;
+        int document_id;
+        std::vector<std::string_view> expected_words;
+    };
+    std::vector<Call> calls(4000);
+    for (Call& call : calls) {
+        const int word_count = std::uniform_int_distribution(1, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            call.query += (i > 0 ? " "s : ""s) + (std::uniform_int_distribution(0, 9)(generator) == 0 ? "-"s : ""s)
+                          + random_word();
+        }
+        call.document_id = std::uniform_int_distribution(0, 99)(generator);
+        call.expected_words = std::get<0>(search_server.MatchDocument(call.query, call.document_id));
+        ASSERT(std::is_sorted(call.expected_words.begin(), call.expected_words.end()));
+        ASSERT(std::adjacent_find(call.expected_words.begin(), call.expected_words.end()) == call.expected_words.end());
+    }
+
+    // Потоки одновременно выполняют разные запросы, обе версии должны совпасть с однопоточным результатом
+    const int thread_count = 8;
+    std::vector<std::thread> threads;
+    std::atomic_int mismatch_count = 0;
+    for (int thread_index = 0; thread_index < thread_count; ++thread_index) {
+        threads.emplace_back([&, thread_index] {
+            for (size_t i = thread_index; i < calls.size(); i += thread_count) {
+                const Call& call = calls[i];
+                const auto [seq_words, seq_status] = search_server.MatchDocument(std::execution::seq, call.query,
+                                                                                  call.document_id);
+                const auto [par_words, par_status] = search_server.MatchDocument(std::execution::par, call.query,
+                                                                                  call.document_id);
+                if (seq_words != call.expected_words || par_words != call.expected_words) {
+                    ++mismatch_count;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQUAL(mismatch_count.load(), 0);
+    std::cout << "Concurrent MatchDocument calls are independent"s << std::endl;
+}
+/*Concurrent MatchDocument calls are independent*/
+
+void TestSnapshotSearchServer() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s};
+    const std::vector<std::string> queries = {"cat dog"s, "funny -rat"s, "curly hair pet"s};
+    const int batch_size = 10;
+    const int batch_count = 100;
+
+    std::mt19937 generator;
+    std::vector<std::string> documents;
+    for (int id = 0; id < batch_size * batch_count; ++id) {
+        std::string document = words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+        for (int i = 0; i < 5; ++i) {
+            document += " "s + words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+        }
+        documents.push_back(document);
+    }
+
+    SearchServer expected_server("and with"s);
+    SnapshotSearchServer snapshot_server(expected_server);
+    std::atomic_bool writer_done = false;
+
+    // Писатель публикует индекс только целыми пачками, каждая третья пачка удаляет предыдущую
+    std::thread writer([&] {
+        for (int batch = 0; batch < batch_count; ++batch) {
+            for (int id = batch * batch_size; id < (batch + 1) * batch_size; ++id) {
+                snapshot_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {id % 5});
+            }
+            if (batch % 3 == 2) {
+                for (int id = (batch - 1) * batch_size; id < batch * batch_size; ++id) {
+                    snapshot_server.RemoveDocument(id);
+                }
+            }
+            snapshot_server.Publish();
+        }
+        writer_done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 4; ++reader) {
+        readers.emplace_back([&, reader] {
+            while (!writer_done) {
+                const auto snapshot = snapshot_server.GetSnapshot();
+                const int document_count = snapshot->GetDocumentCount();
+                ASSERT_EQUAL(document_count % batch_size, 0);
+                const std::string& query = queries[reader % queries.size()];
+                const auto first_result = snapshot->FindTopDocuments(query);
+                const auto second_result = snapshot->FindTopDocuments(query);
+                ASSERT_EQUAL(first_result.size(), second_result.size());
+                for (size_t i = 0; i < first_result.size(); ++i) {
+                    ASSERT_EQUAL(first_result[i].id, second_result[i].id);
+                    ASSERT_EQUAL(first_result[i].relevance, second_result[i].relevance);
+                }
+                if (document_count > 0) {
+                    snapshot->MatchDocument(query, snapshot->GetDocumentId(document_count - 1));
+                }
+            }
+        });
+    }
+    writer.join();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    for (int batch = 0; batch < batch_count; ++batch) {
+        for (int id = batch * batch_size; id < (batch + 1) * batch_size; ++id) {
+            expected_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {id % 5});
+        }
+        if (batch % 3 == 2) {
+            for (int id = (batch - 1) * batch_size; id < batch * batch_size; ++id) {
+                expected_server.RemoveDocument(id);
+            }
+        }
+    }
+    ASSERT_EQUAL(snapshot_server.GetSnapshot()->GetDocumentCount(), expected_server.GetDocumentCount());
+    for (const std::string& query : queries) {
+        AssertSameDocuments(snapshot_server.FindTopDocuments(query), expected_server.FindTopDocuments(query), query);
+    }
+
+    // Publish повторяет удаление на старой копии, и её словарь теряет опустевшие слова.
+    // Слова результата MatchDocument, полученного до этого, ссылаются на запрос и остаются целыми
+    SearchServer collected_server(""s);
+    collected_server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    std::string unique_words = "cat"s;
+    for (int i = 0; i < 2000; ++i) {
+        unique_words += " word"s + std::to_string(i);
+    }
+    collected_server.AddDocument(2, unique_words, DocumentStatus::ACTUAL, {1});
+    SnapshotSearchServer collecting_server(collected_server);
+    const std::string match_query = "word5 cat -dog"s;
+    const auto [matched_words, matched_status] = collecting_server.MatchDocument(std::execution::par, match_query, 2);
+    collecting_server.RemoveDocument(2);
+    collecting_server.Publish();
+    collecting_server.AddDocument(3, "cat word5"s, DocumentStatus::ACTUAL, {1});
+    collecting_server.Publish();
+    ASSERT_EQUAL(matched_words, (std::vector<std::string_view>{"cat", "word5"}));
+    for (const std::string_view word : matched_words) {
+        const bool is_in_query = word.data() >= match_query.data()
+                                 && word.data() + word.size() <= match_query.data() + match_query.size();
+        ASSERT(is_in_query);
+    }
+    const auto [words_after_publish, status_after_publish] = collecting_server.MatchDocument(match_query, 3);
+    ASSERT_EQUAL(words_after_publish, matched_words);
+    std::cout << "SnapshotSearchServer readers see whole batches"s << std::endl;
+}
+/*SnapshotSearchServer readers see whole batches*/
+
+void TestSegmentedSearchServer() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s,
+                                            "and"s};
+    const std::vector<std::string> queries = {"cat dog"s, "funny -rat"s, "curly hair pet -and"s, "nasty"s};
+    std::mt19937 generator;
+
+    SearchServer expected_server("and with"s);
+    expected_server.AddDocument(1000, "funny pet"s, DocumentStatus::ACTUAL, {3});
+    SegmentedSearchServer segmented_server(expected_server, 7);
+
+    const auto check = [&] {
+        ASSERT_EQUAL(segmented_server.GetDocumentCount(), expected_server.GetDocumentCount());
+        for (const std::string& query : queries) {
+            // Порядок документов с одинаковой релевантностью и рейтингом не определён, поэтому сравниваем всё
+            auto result = segmented_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 10'000);
+            auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 10'000);
+            const auto by_id = [](const Document& lhs, const Document& rhs) { return lhs.id < rhs.id; };
+            std::sort(result.begin(), result.end(), by_id);
+            std::sort(expected.begin(), expected.end(), by_id);
+            AssertSameDocuments(result, expected, query);
+            AssertSameDocuments(segmented_server.FindTopDocuments(std::execution::par, query),
+                                expected_server.FindTopDocuments(query), query, false);
+            for (const int document_id : expected_server) {
+                const auto [matched_words, status] = segmented_server.MatchDocument(query, document_id);
+                const auto [expected_words, expected_status] = expected_server.MatchDocument(query, document_id);
+                ASSERT_EQUAL_HINT(matched_words, expected_words, query);
+            }
+        }
+    };
+
+    for (int step = 0; step < 400; ++step) {
+        const int document_id = std::uniform_int_distribution(0, 150)(generator);
+        if (std::uniform_int_distribution(0, 3)(generator) == 0) {
+            segmented_server.RemoveDocument(document_id);
+            expected_server.RemoveDocument(document_id);
+        } else {
+            std::string document = words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+            for (int i = 0; i < 4; ++i) {
+                document += " "s + words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+            }
+            const auto status = static_cast<DocumentStatus>(document_id % 2);
+            bool is_added = true;
+            try {
+                expected_server.AddDocument(document_id, document, status, {document_id % 5});
+            } catch (const std::invalid_argument&) {
+                is_added = false;
+            }
+            try {
+                segmented_server.AddDocument(document_id, document, status, {document_id % 5});
+                ASSERT(is_added);
+            } catch (const std::invalid_argument&) {
+                ASSERT(!is_added);
+            }
+        }
+        if (step % 25 == 24) {
+            segmented_server.Flush();
+            check();
+        }
+    }
+    segmented_server.Flush();
+    segmented_server.WaitForCompaction();
+    ASSERT(segmented_server.GetSegmentCount() <= MAX_SEGMENT_COUNT);
+    check();
+    std::cout << "SegmentedSearchServer matches SearchServer"s << std::endl;
+}
+/*SegmentedSearchServer matches SearchServer*/
+
+void TestAddDocuments() {
+    using namespace std::string_literals;
+    std::mt19937 generator(11);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "and"s, "in"s, "city"s, "park"s, "big"s, "small"s};
+    std::vector<std::string> texts;
+    for (int i = 0; i < 300; ++i) {
+        std::string text = words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+        for (int j = 0; j < 6; ++j) {
+            text += " "s + words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+        }
+        texts.push_back(text);
+    }
+    std::vector<NewDocument> documents;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        documents.push_back({id * 3, texts[id], static_cast<DocumentStatus>(id % 2), {id % 7, -id % 5}});
+    }
+
+    SearchServer expected_server("and in"s);
+    for (const NewDocument& document : documents) {
+        expected_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    SearchServer seq_server("and in"s);
+    seq_server.AddDocuments(std::execution::seq, documents);
+    SearchServer par_server("and in"s);
+    par_server.AddDocument(1, "big city"s, DocumentStatus::ACTUAL, {1});
+    par_server.AddDocuments(std::execution::par, documents);
+    par_server.RemoveDocument(1);
+
+    for (const std::string& query : {"cat dog"s, "big -small"s, "park city cat"s, "and"s}) {
+        const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 10'000);
+        for (const SearchServer* server : {&seq_server, &par_server}) {
+            AssertSameDocuments(server->FindTopDocuments(query, DocumentStatus::ACTUAL, 10'000), expected, query);
+        }
+    }
+
+    // Некорректный документ в пакете не даёт добавить ни один из документов
+    const auto assert_rejected = [&](const std::vector<NewDocument>& batch) {
+        SearchServer search_server("and in"s);
+        search_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+        try {
+            search_server.AddDocuments(std::execution::par, batch);
+            ASSERT(false);
+        } catch (const std::invalid_argument&) {
+        }
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+        ASSERT(search_server.FindTopDocuments("dog"s).empty());
+    };
+    assert_rejected({{2, "dog"s, DocumentStatus::ACTUAL, {}}, {1, "dog"s, DocumentStatus::ACTUAL, {}}});
+    assert_rejected({{2, "dog"s, DocumentStatus::ACTUAL, {}}, {2, "dog"s, DocumentStatus::ACTUAL, {}}});
+    assert_rejected({{2, "dog"s, DocumentStatus::ACTUAL, {}}, {-3, "dog"s, DocumentStatus::ACTUAL, {}}});
+    assert_rejected({{2, "dog"s, DocumentStatus::ACTUAL, {}}, {3, "dog \x12"s, DocumentStatus::ACTUAL, {}}});
+    std::cout << "AddDocuments matches AddDocument"s << std::endl;
+}
+/*AddDocuments matches AddDocument*/
+
+void TestMappedSearchServer() {
+    using namespace std::string_literals;
+    std::mt19937 generator(5);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "and"s, "in"s, "city"s, "park"s, "big"s, "small"s};
+    SearchServer search_server("and in"s);
+    for (int id = 0; id < 200; ++id) {
+        std::string document = words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+        for (int i = 0; i < 5; ++i) {
+            document += " "s + words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+        }
+        search_server.AddDocument(id * 7 % 200, document, static_cast<DocumentStatus>(id % 3), {id % 11, 4});
+    }
+    for (int id = 0; id < 200; id += 9) {
+        search_server.RemoveDocument(id);
+    }
+    const std::string path = (std::filesystem::temp_directory_path() / "search_server_test.idx").string();
+    SaveIndex(search_server, path);
+
+    {
+        const MappedSearchServer mapped_server(path);
+        mapped_server.Validate();
+        ASSERT_EQUAL(mapped_server.GetDocumentCount(), search_server.GetDocumentCount());
+        for (const std::string& query : {"cat dog"s, "big -small"s, "park city cat"s, "and"s, "unknown -cat"s}) {
+            for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED}) {
+                const auto expected = search_server.FindTopDocuments(query, status, 10'000);
+                AssertSameDocuments(mapped_server.FindTopDocuments(query, status, 10'000), expected, query);
+                AssertSameDocuments(mapped_server.FindTopDocuments(std::execution::par, query, status, 10'000),
+                                    expected, query, false);
+            }
+            for (const int document_id : search_server) {
+                const auto [matched_words, status] = mapped_server.MatchDocument(query, document_id);
+                const auto [expected_words, expected_status] = search_server.MatchDocument(query, document_id);
+                ASSERT_EQUAL_HINT(matched_words, expected_words, query);
+                ASSERT_HINT(status == expected_status, query);
+            }
+        }
+        try {
+            mapped_server.MatchDocument("cat"s, 0);
+            ASSERT(false);
+        } catch (const std::out_of_range&) {
+        }
+    }
+
+    // Обрезанный файл не открывается
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    try {
+        MappedSearchServer mapped_server(path);
+        ASSERT(false);
+    } catch (const std::runtime_error&) {
+    }
+
+    // Испорченный байт либо отвергается при открытии или проверкой, либо даёт файл, который читается
+    // без выхода за секции
+    SearchServer small_server("and"s);
+    small_server.AddDocument(3, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    small_server.AddDocument(1, "dog in park"s, DocumentStatus::BANNED, {2});
+    small_server.AddDocument(2, "big cat"s, DocumentStatus::ACTUAL, {3});
+    SaveIndex(small_server, path);
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    size_t rejected_count = 0;
+    for (size_t position = 0; position < bytes.size(); ++position) {
+        std::string corrupted_bytes = bytes;
+        corrupted_bytes[position] = static_cast<char>(~corrupted_bytes[position]);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << corrupted_bytes;
+        try {
+            const MappedSearchServer mapped_server(path);
+            mapped_server.Validate();
+            for (const std::string& query : {"cat dog"s, "park -big"s, "and"s}) {
+                mapped_server.FindTopDocuments(query);
+                mapped_server.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED);
+                for (const int document_id : small_server) {
+                    try {
+                        mapped_server.MatchDocument(query, document_id);
+                    } catch (const std::out_of_range&) {
+                    }
+                }
+            }
+        } catch (const std::runtime_error&) {
+            ++rejected_count;
+        }
+    }
+    // Целыми остаются только байты частот, рейтингов, символов слов, заполнителей и части id
+    ASSERT(rejected_count * 2 > bytes.size());
+    std::filesystem::remove(path);
+    std::cout << "MappedSearchServer matches SearchServer"s << std::endl;
+}
+/*MappedSearchServer matches SearchServer*/
+
+void TestPostingList() {
+    using namespace std::string_literals;
+    std::mt19937 generator(3);
+    PostingList postings;
+    std::map<int, int> expected;
+    int ordinal = 0;
+    for (int i = 0; i < 1'000; ++i) {
+        // Разности разной длины проверяют varint на границах байтов
+        ordinal += std::uniform_int_distribution(1, i % 3 == 0 ? 1'000'000 : 100)(generator);
+        const int count = std::uniform_int_distribution(1, 300)(generator);
+        postings.PushBack(ordinal, count);
+        expected[ordinal] = count;
+    }
+    const auto check = [&] {
+        ASSERT_EQUAL(postings.GetSize(), expected.size());
+        std::vector<std::pair<int, int>> result;
+        postings.ForEach([&result](int posting_ordinal, int count) { result.emplace_back(posting_ordinal, count); });
+        const std::vector<std::pair<int, int>> expected_result(expected.begin(), expected.end());
+        ASSERT(result == expected_result);
+
+        std::atomic<size_t> par_count = 0;
+        std::atomic<long long> par_sum = 0;
+        postings.ForEach(std::execution::par, [&](int posting_ordinal, int count) {
+            ++par_count;
+            par_sum += static_cast<long long>(posting_ordinal) * count;
+        });
+        long long expected_sum = 0;
+        for (const auto&[posting_ordinal, count] : expected) {
+            expected_sum += static_cast<long long>(posting_ordinal) * count;
+        }
+        ASSERT_EQUAL(par_count.load(), expected.size());
+        ASSERT_EQUAL(par_sum.load(), expected_sum);
+
+        // Переходы вперёд внутри блока, через блоки и за конец списка
+        PostingList::Cursor cursor(postings);
+        int target = 0;
+        while (true) {
+            target += std::uniform_int_distribution(0, 3'000'000)(generator);
+            cursor.SkipTo(target);
+            const auto expected_it = expected.lower_bound(target);
+            ASSERT_EQUAL(cursor.IsEnd(), expected_it == expected.end());
+            if (cursor.IsEnd()) {
+                break;
+            }
+            ASSERT_EQUAL(cursor.GetOrdinal(), expected_it->first);
+            ASSERT_EQUAL(cursor.GetCount(), expected_it->second);
+            target = cursor.GetOrdinal();
+        }
+    };
+    check();
+
+    postings.Erase(expected.begin()->first);
+    expected.erase(expected.begin());
+    postings.Erase(std::prev(expected.end())->first);
+    expected.erase(std::prev(expected.end()));
+    postings.Erase(-5);
+    postings.Erase(ordinal + 10);
+    check();
+    while (expected.size() > 10) {
+        auto it = std::next(expected.begin(), std::uniform_int_distribution<size_t>(0, expected.size() - 1)(generator));
+        postings.Erase(it->first);
+        postings.Erase(it->first);
+        expected.erase(it);
+    }
+    check();
+    postings.PushBack(ordinal + 1, 2);
+    expected[ordinal + 1] = 2;
+    check();
+    while (!expected.empty()) {
+        postings.Erase(expected.begin()->first);
+        expected.erase(expected.begin());
+    }
+    check();
+    ASSERT(postings.IsEmpty());
+
+    // Удаления из середины оставляют свободные байты между блоками. Дописывание после удаления
+    // последнего блока и переписывание блоков подряд не должны их задеть
+    for (int i = 1; i <= 300; ++i) {
+        postings.PushBack(i * 200, i % 7 + 1);
+        expected[i * 200] = i % 7 + 1;
+    }
+    for (const int removed : {3'000, 30'000, 40'000}) {
+        postings.Erase(removed);
+        expected.erase(removed);
+    }
+    while (std::prev(expected.end())->first > 256 * 200) {
+        postings.Erase(std::prev(expected.end())->first);
+        expected.erase(std::prev(expected.end()));
+    }
+    check();
+    for (int i = 1; i <= 200; ++i) {
+        postings.PushBack(60'000 + i, i);
+        expected[60'000 + i] = i;
+    }
+    check();
+    for (auto it = expected.begin(); it != expected.end();) {
+        postings.Erase(it->first);
+        it = expected.erase(it);
+        if (it != expected.end()) {
+            ++it;
+        }
+    }
+    check();
+    std::cout << "PostingList matches std::map"s << std::endl;
+}
+/*PostingList matches std::map*/
+
+void TestQueryCache() {
+    using namespace std::string_literals;
+    SearchServer search_server("and in"s);
+    search_server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {5, -12, 2, 1});
+
+    QueryCache cache(4, 2);
+    const auto assert_cached_equal = [&](const std::string& query, DocumentStatus status) {
+        AssertSameDocuments(cache.FindTopDocuments(search_server, query, status),
+                            search_server.FindTopDocuments(query, status), query);
+    };
+
+    // Порядок слов, повторы и стоп-слова не меняют ключ
+    assert_cached_equal("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    assert_cached_equal("cat fluffy cat and -dog"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(cache.GetStats().hit_count, 1u);
+    ASSERT_EQUAL(cache.GetStats().miss_count, 1u);
+    // Другой статус или минус-слова — другой запрос
+    assert_cached_equal("fluffy cat -dog"s, DocumentStatus::BANNED);
+    assert_cached_equal("fluffy cat dog"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(cache.GetStats().miss_count, 3u);
+
+    // Изменение индекса делает записи устаревшими
+    search_server.AddDocument(4, "fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    assert_cached_equal("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    search_server.RemoveDocument(2);
+    assert_cached_equal("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(cache.GetStats().miss_count, 5u);
+    assert_cached_equal("fluffy cat -dog"s, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(cache.GetStats().hit_count, 2u);
+
+    // Размер кеша ограничен
+    for (const std::string& query : {"a"s, "b"s, "c"s, "d"s, "e"s, "f"s, "g"s}) {
+        assert_cached_equal(query, DocumentStatus::ACTUAL);
+    }
+    ASSERT(cache.GetSize() <= 4);
+    cache.Clear();
+    ASSERT_EQUAL(cache.GetSize(), 0u);
+    // Шардов по умолчанию больше, чем запросов, но ёмкость всё равно соблюдается точно
+    QueryCache small_cache(3);
+    for (const std::string& query : {"a"s, "b"s, "c"s, "d"s, "e"s, "f"s, "g"s, "h"s, "i"s, "j"s, "k"s, "l"s}) {
+        small_cache.FindTopDocuments(search_server, query);
+    }
+    ASSERT_EQUAL(small_cache.GetSize(), 3u);
+
+    RequestQueue request_queue(search_server, cache);
+    request_queue.AddFindRequest("sparrow"s);
+    request_queue.AddFindRequest("sparrow"s);
+    request_queue.AddFindRequest("cat"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 2);
+    const auto stats = cache.GetStats();
+    ASSERT_EQUAL(stats.hit_count, 3u);
+    ASSERT_EQUAL(stats.miss_count, 14u);
+    std::cout << "QueryCache hit rate "s << stats.hit_rate << std::endl;
+}
+/*QueryCache hit rate 0.176471*/
+
+void TestQueryParsingDoesNotAllocate() {
+    using namespace std::string_literals;
+    SearchServer search_server("and in at"s);
+    search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+
+    // Слов запроса нет в индексе, поэтому вся работа — разбор запроса
+    const std::string unknown_query = "sparrow -owl in the garden garden -owl"s;
+    // Минус-слово есть в документе, и MatchDocument возвращает пустой список
+    const std::string minus_query = "fancy cat -curly at"s;
+#ifdef SEARCH_SERVER_COUNT_ALLOCATIONS
+    const auto count_allocations = [](const auto& function) {
+        const size_t allocation_count_before = GetThreadAllocationCount();
+        function();
+        return GetThreadAllocationCount() - allocation_count_before;
+    };
+    ASSERT_EQUAL(count_allocations([&] { search_server.FindTopDocuments(unknown_query); }), 0u);
+    ASSERT_EQUAL(count_allocations([&] { search_server.MatchDocument(minus_query, 1); }), 0u);
+#else
+    // Без флага operator new не заменён, проверяются только результаты разбора
+    ASSERT(search_server.FindTopDocuments(unknown_query).empty());
+    ASSERT(std::get<0>(search_server.MatchDocument(minus_query, 1)).empty());
+#endif
+
+    // Длинный запрос не помещается во встроенный буфер, но разбирается так же
+    std::string long_query = "curly"s;
+    for (int i = 0; i < 40; ++i) {
+        long_query += " word"s + std::to_string(i % 20);
+    }
+    const auto documents = search_server.FindTopDocuments(long_query + " -dog"s);
+    ASSERT_EQUAL(documents.size(), 1u);
+    ASSERT_EQUAL(documents[0].id, 1);
+    const auto [matched_words, status] = search_server.MatchDocument(long_query + " tail tail"s, 1);
+    ASSERT_EQUAL(matched_words, (std::vector<std::string_view>{"curly", "tail"}));
+    std::cout << "Query parsing does not allocate"s << std::endl;
+}
+/*Query parsing does not allocate*/
+
+void TestTokenize() {
+    using namespace std::string_literals;
+    // Поштучный разбор, который заменил Tokenize
+    const auto tokenize_by_find = [](std::string_view text) {
+        TokenizedText result;
+        while (true) {
+            const size_t space = text.find(' ');
+            result.words.push_back(text.substr(0, space));
+            if (space == text.npos) {
+                break;
+            }
+            text.remove_prefix(space + 1);
+        }
+        result.first_invalid_word = std::find_if(result.words.begin(), result.words.end(), [](std::string_view word) {
+            return std::any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; });
+        }) - result.words.begin();
+        return result;
+    };
+
+    std::mt19937 generator(17);
+    const std::string alphabet = "ab    \x01\x1f\x7f\x80\xff-"s;
+    for (int i = 0; i < 2'000; ++i) {
+        std::string text;
+        const int length = std::uniform_int_distribution(0, 100)(generator);
+        // В половине текстов управляющих символов нет, иначе первый из них почти всегда в начале
+        const size_t letter_count = i % 2 == 0 ? alphabet.size() : 6;
+        for (int j = 0; j < length; ++j) {
+            text += alphabet[std::uniform_int_distribution<size_t>(0, letter_count - 1)(generator)];
+        }
+        if (i % 4 == 1 && !text.empty()) {
+            text[std::uniform_int_distribution<size_t>(0, text.size() - 1)(generator)] = '\n';
+        }
+        const auto result = Tokenize(text);
+        const auto expected = tokenize_by_find(text);
+        ASSERT_EQUAL(result.words.size(), expected.words.size());
+        for (size_t j = 0; j < result.words.size(); ++j) {
+            ASSERT(result.words[j].data() == expected.words[j].data());
+            ASSERT_EQUAL(result.words[j], expected.words[j]);
+        }
+        ASSERT_EQUAL(result.first_invalid_word, expected.first_invalid_word);
+    }
+    std::cout << "Tokenize matches find-based splitting"s << std::endl;
+}
+/*Tokenize matches find-based splitting*/
+
+void TestInverseDocumentFreqCache() {
+    using namespace std::string_literals;
+    const std::vector<std::string> texts = {"white cat and fashionable collar"s, "fluffy cat fluffy tail"s,
+                                            "groomed dog expressive eyes"s, "groomed starling eugene"s,
+                                            "fluffy dog and white collar"s};
+    const std::vector<std::string> queries = {"fluffy groomed cat"s, "white dog -eyes"s, "collar starling"s};
+
+    // Сервер с прогретым кешем сравнивается с сервером, собранным с нуля после каждого изменения
+    SearchServer search_server("and"s);
+    std::vector<int> document_ids;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        document_ids.push_back(id);
+        ProcessQueries(search_server, queries);
+        SearchServer expected_server("and"s);
+        for (const int document_id : document_ids) {
+            expected_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {document_id});
+        }
+        AssertSameTopDocuments(search_server, expected_server, queries);
+    }
+    for (const int removed_id : {1, 3}) {
+        search_server.RemoveDocument(removed_id);
+        document_ids.erase(std::find(document_ids.begin(), document_ids.end(), removed_id));
+        SearchServer expected_server("and"s);
+        for (const int document_id : document_ids) {
+            expected_server.AddDocument(document_id, texts[document_id], DocumentStatus::ACTUAL, {document_id});
+        }
+        AssertSameTopDocuments(search_server, expected_server, queries);
+    }
+
+    // Копия получает готовые значения и продолжает считать сама после изменений
+    SearchServer copy = search_server;
+    AssertSameTopDocuments(copy, search_server, queries);
+    copy.AddDocument(10, "cat starling"s, DocumentStatus::ACTUAL, {1});
+    const auto copy_result = copy.FindTopDocuments("starling"s);
+    ASSERT_EQUAL(copy_result.size(), 1u);
+    ASSERT_EQUAL(copy_result[0].relevance, 0.5 * log(4.0 / 1.0));
+    std::cout << "Cached IDF matches recomputed IDF"s << std::endl;
+}
+/*Cached IDF matches recomputed IDF*/
+
 void
 AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
            const std::string& hint) {
@@ -193,4 +1107,433 @@ AssertImpl(bool value, const std::string& expr_str, const std::string& file, con
         std::cerr << std::endl;
         abort();
     }
-}
\ No newline at end of file
+}
+void TestDynamicPruning() {
+    // Частоты слов убывают по закону Ципфа: частые слова дают длинные списки, которые отсекаются
+    std::vector<std::string> words;
+    std::vector<double> weights;
+    for (int i = 0; i < 50; ++i) {
+        words.push_back("word"s + std::to_string(i));
+        weights.push_back(1.0 / (i + 1));
+    }
+    std::mt19937 generator(23);
+    std::discrete_distribution<size_t> word_distribution(weights.begin(), weights.end());
+    SearchServer search_server("word49"s);
+    for (int id = 0; id < 5000; ++id) {
+        std::string document;
+        const int word_count = std::uniform_int_distribution(1, 20)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            document += words[word_distribution(generator)] + " "s;
+        }
+        search_server.AddDocument(id, document, static_cast<DocumentStatus>(id % 4),
+                                  {std::uniform_int_distribution(-5, 5)(generator)});
+    }
+    for (int id = 0; id < 5000; id += 7) {
+        search_server.RemoveDocument(id);
+    }
+
+    // Полный перебор остаётся в параллельной версии, с ней и сравниваются результаты
+    const std::vector<std::string> queries = {"word0 word1"s, "word0 word1 word2 word3 word4"s,
+                                              "word0 word5 word30 -word2"s, "word48 word0"s, "word49 word0 word1"s,
+                                              "word40 word41 word42 word0 -word1 -word3"s, "word10 word0 word1"s};
+    for (const std::string& query : queries) {
+        for (const size_t top_count : {size_t(0), size_t(1), size_t(5), size_t(50), size_t(5000)}) {
+            const auto is_even_actual = [](int document_id, DocumentStatus status, int) {
+                return status == DocumentStatus::ACTUAL && document_id % 2 == 0;
+            };
+            const auto pruned = search_server.FindTopDocuments(std::execution::seq, query, is_even_actual, top_count);
+            const auto expected = search_server.FindTopDocuments(std::execution::par, query, is_even_actual,
+                                                                 top_count);
+            AssertSameDocuments(pruned, expected, query, false);
+        }
+    }
+    std::cout << "Pruned FindTopDocuments matches exhaustive search"s << std::endl;
+}
+/*Pruned FindTopDocuments matches exhaustive search*/
+
+void TestMinusWordsExcludeDocuments() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "groomed dog"s, DocumentStatus::ACTUAL, {3});
+    search_server.AddDocument(4, "fluffy dog and white collar"s, DocumentStatus::ACTUAL, {4});
+    search_server.AddDocument(5, "starling"s, DocumentStatus::ACTUAL, {5});
+    search_server.RemoveDocument(5);
+
+    const auto find_ids = [&search_server](const auto& policy, std::string_view query, size_t top_count) {
+        std::vector<int> ids;
+        for (const Document& document : search_server.FindTopDocuments(policy, query, DocumentStatus::ACTUAL,
+                                                                       top_count)) {
+            ids.push_back(document.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    // Минус-слово без документов и неизвестное минус-слово ничего не исключают
+    const std::vector<std::pair<std::string, std::vector<int>>> queries = {
+            {"cat dog -white"s,              {2, 3}},
+            {"cat dog -fluffy -groomed"s,    {1}},
+            {"cat dog -starling -unknown"s,  {1, 2, 3, 4}},
+            {"collar -collar"s,              {}}};
+    for (const auto& [query, expected_ids] : queries) {
+        for (const size_t top_count : {size_t(1), size_t(MAX_RESULT_DOCUMENT_COUNT)}) {
+            const auto seq_ids = find_ids(std::execution::seq, query, top_count);
+            const auto par_ids = find_ids(std::execution::par, query, top_count);
+            ASSERT_EQUAL_HINT(seq_ids.size(), std::min(top_count, expected_ids.size()), query);
+            ASSERT_HINT(std::includes(expected_ids.begin(), expected_ids.end(), seq_ids.begin(), seq_ids.end()),
+                        query);
+            ASSERT_HINT(seq_ids == par_ids, query);
+        }
+    }
+    std::cout << "Minus words exclude documents before scoring"s << std::endl;
+}
+/*Minus words exclude documents before scoring*/
+
+void TestProcessQueriesBatch() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s};
+    SearchServer search_server("and with"s);
+    std::mt19937 generator(29);
+    const auto random_word = [&words, &generator] {
+        return words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+    };
+    for (int id = 0; id < 3000; ++id) {
+        std::string document = random_word();
+        for (int i = 0; i < 12; ++i) {
+            document += " "s + random_word();
+        }
+        search_server.AddDocument(id, document, static_cast<DocumentStatus>(id % 4), {id % 11, -(id % 5)});
+    }
+    search_server.RemoveDocument(10);
+
+    std::vector<std::string> queries = {"unknown"s, "cat -cat"s, "rat"s};
+    for (int i = 0; i < 500; ++i) {
+        std::string query = random_word();
+        for (int j = 0; j < 3; ++j) {
+            query += (std::uniform_int_distribution(0, 3)(generator) == 0 ? " -"s : " "s) + random_word();
+        }
+        queries.push_back(query);
+    }
+    const auto results = ProcessQueries(search_server, queries);
+    ASSERT_EQUAL(results.size(), queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        AssertSameDocuments(results[i], search_server.FindTopDocuments(queries[i]), queries[i], false);
+    }
+
+    // Список слова cat длиннее предела раскодирования и обходится курсором сжатого списка
+    SearchServer large_server("and with"s);
+    for (int id = 0; id < 70'000; ++id) {
+        large_server.AddDocument(id, "cat "s + random_word() + " "s + random_word(), DocumentStatus::ACTUAL,
+                                 {id % 13});
+    }
+    const std::vector<std::string> large_queries = {"cat"s, "cat dog"s, "rat -cat"s, "dog -rat funny"s,
+                                                    "cat hair -pet"s};
+    const auto large_results = ProcessQueries(large_server, large_queries);
+    for (size_t i = 0; i < large_queries.size(); ++i) {
+        AssertSameDocuments(large_results[i], large_server.FindTopDocuments(large_queries[i]), large_queries[i],
+                            false);
+    }
+
+    // Некорректный запрос приводит к тому же исключению, что и одиночный поиск
+    bool is_thrown = false;
+    try {
+        ProcessQueries(search_server, {"cat"s, "dog --rat"s});
+    } catch (const std::invalid_argument&) {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+
+    // Пул вызывает функцию ровно один раз для каждого индекса
+    WorkStealingPool pool(3);
+    std::vector<std::atomic<int>> call_counts(1000);
+    pool.ForEachIndex(call_counts.size(), [&call_counts, &pool](size_t worker_index, size_t index) {
+        ASSERT(worker_index < pool.GetThreadCount());
+        ++call_counts[index];
+    });
+    ASSERT(std::all_of(call_counts.begin(), call_counts.end(), [](const std::atomic<int>& count) {
+        return count == 1;
+    }));
+    std::cout << "Batched ProcessQueries matches FindTopDocuments"s << std::endl;
+}
+/*Batched ProcessQueries matches FindTopDocuments*/
+
+void TestProcessQueriesJoinedIsLazy() {
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "pet"s, "funny"s, "nasty"s, "curly"s, "hair"s};
+    SearchServer search_server("and with"s);
+    std::mt19937 generator(31);
+    const auto random_word = [&words, &generator] {
+        return words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+    };
+    for (int id = 0; id < 500; ++id) {
+        search_server.AddDocument(id, random_word() + " "s + random_word() + " "s + random_word(),
+                                  DocumentStatus::ACTUAL, {id % 9});
+    }
+    // Запросов на несколько пачек, часть пачек без результатов
+    std::vector<std::string> queries;
+    for (size_t i = 0; i < 3 * JOINED_QUERY_BATCH_SIZE + 7; ++i) {
+        queries.push_back(i / JOINED_QUERY_BATCH_SIZE == 1 ? "unknown"s : random_word() + " "s + random_word());
+    }
+
+    std::vector<Document> expected;
+    for (const auto& documents : ProcessQueries(search_server, queries)) {
+        expected.insert(expected.end(), documents.begin(), documents.end());
+    }
+    size_t index = 0;
+    for (const Document& document : ProcessQueriesJoined(search_server, queries)) {
+        ASSERT(index < expected.size());
+        ASSERT_EQUAL(document.id, expected[index].id);
+        ASSERT_EQUAL(document.relevance, expected[index].relevance);
+        ++index;
+    }
+    ASSERT_EQUAL(index, expected.size());
+
+    // Диапазон можно бросить, не дочитав: фоновый поток останавливается
+    for (const Document& document : ProcessQueriesJoined(search_server, queries)) {
+        ASSERT_EQUAL(document.id, expected[0].id);
+        break;
+    }
+
+    // Ошибка в запросе последней пачки бросается, когда до неё доходит чтение
+    queries.back() = "cat --dog"s;
+    size_t read_count = 0;
+    bool is_thrown = false;
+    try {
+        for ([[maybe_unused]] const Document& document : ProcessQueriesJoined(search_server, queries)) {
+            ++read_count;
+        }
+    } catch (const std::invalid_argument&) {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+    ASSERT(read_count > 0);
+    std::cout << "ProcessQueriesJoined streams documents in query order"s << std::endl;
+}
+/*ProcessQueriesJoined streams documents in query order*/
+
+void TestRequestQueueWindow() {
+    LatencyHistogram histogram;
+    for (uint64_t nanoseconds = 1; nanoseconds <= 1000; ++nanoseconds) {
+        histogram.Add(nanoseconds * 1000);
+    }
+    // Перцентиль завышается не больше чем на восьмую часть
+    for (const double quantile : {0.5, 0.9, 0.99}) {
+        const double exact = quantile * 1'000'000;
+        const double percentile = double(histogram.GetPercentile(quantile));
+        ASSERT(percentile >= exact && percentile <= exact * 1.125);
+    }
+    histogram.Remove(1000);
+    ASSERT_EQUAL(histogram.GetCount(), 999u);
+    ASSERT_EQUAL(LatencyHistogram().GetPercentile(0.5), 0u);
+
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+    RequestQueue request_queue(search_server);
+    for (int i = 0; i < 1439; ++i) {
+        request_queue.AddFindRequest("empty request"s);
+    }
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1439);
+    request_queue.AddFindRequest("curly dog"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1440);
+    // Новые запросы вытесняют самые старые
+    request_queue.AddFindRequest("cat"s);
+    request_queue.AddFindRequest("white"s);
+    request_queue.AddFindRequest("sparrow"s);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1438);
+    auto stats = request_queue.GetStats();
+    ASSERT_EQUAL(stats.request_count, REQUEST_WINDOW_SIZE);
+    ASSERT_EQUAL(stats.result_count_histogram[0], 1438u);
+    ASSERT_EQUAL(stats.result_count_histogram[1], 1u);
+    ASSERT_EQUAL(stats.result_count_histogram[2], 1u);
+    ASSERT(stats.latency_p50 <= stats.latency_p90 && stats.latency_p90 <= stats.latency_p99);
+
+    // Запросы из нескольких потоков учитываются все
+    RequestQueue shared_queue(search_server);
+    std::vector<std::thread> threads;
+    for (int thread_index = 0; thread_index < 4; ++thread_index) {
+        threads.emplace_back([&shared_queue] {
+            for (int i = 0; i < 100; ++i) {
+                shared_queue.AddFindRequest(i % 2 == 0 ? "cat"s : "sparrow"s);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    stats = shared_queue.GetStats();
+    ASSERT_EQUAL(stats.request_count, 400u);
+    ASSERT_EQUAL(stats.no_result_count, 200u);
+    ASSERT_EQUAL(stats.result_count_histogram[2], 200u);
+    std::cout << "RequestQueue keeps statistics of the last "s << stats.request_count << " of 400 requests"s
+              << std::endl;
+}
+/*RequestQueue keeps statistics of the last 400 of 400 requests*/
+
+void TestStageLatencies() {
+    ResetStageLatencies();
+    RecordStageLatency(SearchStage::TOP_K, std::chrono::microseconds(3));
+    std::thread([] {
+        RecordStageLatency(SearchStage::TOP_K, std::chrono::microseconds(5));
+    }).join();
+    // Гистограммы завершившихся потоков сохраняются
+    auto latencies = GetStageLatencies();
+    ASSERT_EQUAL(latencies[static_cast<size_t>(SearchStage::TOP_K)].GetCount(), 2u);
+    ASSERT(latencies[static_cast<size_t>(SearchStage::TOP_K)].GetPercentile(1.0) >= 5000u);
+
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {2});
+    search_server.FindTopDocuments("cat -collar"s);
+    latencies = GetStageLatencies();
+#ifdef SEARCH_SERVER_METRICS
+    ASSERT_EQUAL(latencies[static_cast<size_t>(SearchStage::PARSE)].GetCount(), 1u);
+    ASSERT_EQUAL(latencies[static_cast<size_t>(SearchStage::MINUS_EXCLUSION)].GetCount(), 1u);
+    ASSERT_EQUAL(latencies[static_cast<size_t>(SearchStage::TOP_K)].GetCount(), 3u);
+#else
+    // Без флага замеры в поиске не компилируются
+    ASSERT_EQUAL(latencies[static_cast<size_t>(SearchStage::PARSE)].GetCount(), 0u);
+#endif
+
+    const std::string text = DumpStageLatenciesText();
+    const std::string json = DumpStageLatenciesJson();
+    for (size_t stage = 0; stage < SEARCH_STAGE_COUNT; ++stage) {
+        const std::string name(GetStageName(static_cast<SearchStage>(stage)));
+        ASSERT(text.find(name + ": count "s) != std::string::npos);
+        ASSERT(json.find("\""s + name + "\":{\"count\":"s) != std::string::npos);
+    }
+    ASSERT_EQUAL(json.front(), '{');
+    ASSERT_EQUAL(json.back(), '}');
+    ResetStageLatencies();
+    ASSERT_EQUAL(GetStageLatencies()[static_cast<size_t>(SearchStage::TOP_K)].GetCount(), 0u);
+    std::cout << "Stage latencies are collected from all threads"s << std::endl;
+}
+/*Stage latencies are collected from all threads*/
+
+void TestRemoveDuplicates() {
+    const auto make_server = [] {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        // Дубликат документа 2
+        search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        // Отличается только стоп-словами, дубликат
+        search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        // Множество слов такое же, дубликат документа 1
+        search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+        // Добавились новые слова, не дубликат
+        search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+        // Множество слов такое же, как в id 6, несмотря на другой порядок, дубликат
+        search_server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+        // Есть не все слова, не дубликат
+        search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+        // Слова из разных документов, не дубликат
+        search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        return search_server;
+    };
+    const std::vector<int> expected_ids = {3, 4, 5, 7};
+    for (const bool is_parallel : {false, true}) {
+        SearchServer search_server = make_server();
+        const auto duplicate_ids = is_parallel ? RemoveDuplicates(std::execution::par, search_server)
+                                               : RemoveDuplicates(search_server);
+        ASSERT(duplicate_ids == expected_ids);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+        ASSERT(std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>({1, 2, 6, 8, 9}));
+        // Удаление пачкой оставляет индекс таким же, как у сервера без дубликатов
+        SearchServer fresh_server("and with"s);
+        fresh_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+        fresh_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        fresh_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+        fresh_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+        fresh_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+        AssertSameTopDocuments(search_server, fresh_server, {"funny rat"s, "curly pet -very"s, "nasty hair"s});
+        ASSERT(RemoveDuplicates(search_server).empty());
+    }
+
+    // Почти-дубликаты: 11 отличается от 10 одним словом из одиннадцати (мера 9 / 11), 12 — половиной
+    SearchServer search_server(""s);
+    search_server.AddDocument(10, "a b c d e f g h i j"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(11, "a b c d e f g h i k"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(12, "a b c d e v w x y z"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(13, "j i h g f e d c b a"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(RemoveNearDuplicates(std::execution::par, search_server, 0.8) == std::vector<int>({11, 13}));
+    ASSERT(std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>({10, 12}));
+    bool is_rejected = false;
+    try {
+        RemoveNearDuplicates(search_server, 1.5);
+    } catch (const std::invalid_argument&) {
+        is_rejected = true;
+    }
+    ASSERT(is_rejected);
+    std::cout << "RemoveDuplicates keeps the document with the lowest id"s << std::endl;
+}
+/*RemoveDuplicates keeps the document with the lowest id*/
+
+void TestWordFrequencies() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and white collar"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "fluffy dog"s, DocumentStatus::ACTUAL, {1});
+    const auto to_map = [](const SearchServer::WordFrequencies& word_frequencies) {
+        std::map<std::string, double> frequencies;
+        for (const auto [word, frequency] : word_frequencies) {
+            frequencies.emplace(word, frequency);
+        }
+        return frequencies;
+    };
+    const std::map<std::string, double> expected_first = {{"cat"s, 0.25}, {"collar"s, 0.25}, {"white"s, 0.5}};
+    ASSERT(to_map(search_server.GetWordFrequencies(1)) == expected_first);
+    // Слова прочитанного раньше документа не попадают в частоты следующего
+    const auto second = search_server.GetWordFrequencies(2);
+    ASSERT_EQUAL(second.size(), 2u);
+    const std::map<std::string, double> expected_second = {{"dog"s, 0.5}, {"fluffy"s, 0.5}};
+    ASSERT(to_map(second) == expected_second);
+    ASSERT_EQUAL(second.GetFrequency("dog"s), 0.5);
+    ASSERT_EQUAL(second.GetFrequency("cat"s), 0.0);
+    ASSERT_EQUAL(second.GetFrequency("parrot"s), 0.0);
+    ASSERT(search_server.GetWordFrequencies(3).empty());
+    ASSERT_EQUAL(search_server.GetWordFrequencies(3).GetFrequency("cat"s), 0.0);
+
+    // Без общего состояния потоки читают частоты разных документов одновременно
+    for (int id = 3; id < 200; ++id) {
+        search_server.AddDocument(id, "word"s + std::to_string(id) + " shared"s, DocumentStatus::ACTUAL, {1});
+    }
+    std::atomic<bool> is_consistent = true;
+    std::vector<std::thread> threads;
+    for (int thread_index = 0; thread_index < 4; ++thread_index) {
+        threads.emplace_back([&search_server, &is_consistent, thread_index] {
+            for (int id = 3 + thread_index; id < 200; id += 4) {
+                const auto word_frequencies = search_server.GetWordFrequencies(id);
+                const std::string word = "word"s + std::to_string(id);
+                if (word_frequencies.size() != 2 || word_frequencies.GetFrequency(word) != 0.5
+                    || word_frequencies.GetFrequency("shared"s) != 0.5) {
+                    is_consistent = false;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT(is_consistent);
+    std::cout << "GetWordFrequencies reads the forward index without copying"s << std::endl;
+}
+/*GetWordFrequencies reads the forward index without copying*/
+
+void TestWorkStealingPoolReuse() {
+    // Поток, не успевший выйти из прошлого запуска, не должен перехватить задачи следующего раньше,
+    // чем запуск посчитает их: иначе счётчики не сойдутся и ForEachIndex не вернётся
+    WorkStealingPool pool(4);
+    std::atomic<size_t> total = 0;
+    const int run_count = 20'000;
+    for (int run = 0; run < run_count; ++run) {
+        pool.ForEachIndex(1 + run % 7, [&total](size_t, size_t index) {
+            total += index + 1;
+        });
+    }
+    size_t expected_total = 0;
+    for (int run = 0; run < run_count; ++run) {
+        const size_t count = 1 + run % 7;
+        expected_total += count * (count + 1) / 2;
+    }
+    ASSERT_EQUAL(total.load(), expected_total);
+    std::cout << "WorkStealingPool can be reused back to back"s << std::endl;
+}
+/*WorkStealingPool can be reused back to back*/
@@ -4,6 +4,14 @@
 
 #include "search_server.h"
 #include "process_queries.h"
+#include "mapped_search_server.h"
+#include "query_cache.h"
+#include "remove_duplicates.h"
+#include "request_queue.h"
+#include "segmented_search_server.h"
+#include "snapshot_search_server.h"
+#include "stage_latency.h"
+#include "work_stealing_pool.h"
 
 using std::string_literals::operator""s;
 
@@ -32,6 +40,59 @@ void TestRemoveFunction();
 
 void TestMatchDocument();
 
+void TestParallelFindTopDocuments();
+
+void TestSelectTopDocuments();
+
+void TestTermDictionary();
+
+void TestRemoveDocumentKeepsIndexConsistent();
+
+void TestRemovedOrdinalsAreCompacted();
+
+void TestConcurrentMatchDocument();
+
+void TestSnapshotSearchServer();
+
+void TestSegmentedSearchServer();
+
+void TestAddDocuments();
+
+void TestMappedSearchServer();
+
+void TestPostingList();
+
+void TestQueryCache();
+
+#ifdef SEARCH_SERVER_COUNT_ALLOCATIONS
+// Число обращений текущего потока к operator new, заменённому в allocation_counter.cpp
+size_t GetThreadAllocationCount();
+#endif
+
+void TestQueryParsingDoesNotAllocate();
+
+void TestTokenize();
+
+void TestInverseDocumentFreqCache();
+
+void TestDynamicPruning();
+
+void TestMinusWordsExcludeDocuments();
+
+void TestProcessQueriesBatch();
+
+void TestProcessQueriesJoinedIsLazy();
+
+void TestRequestQueueWindow();
+
+void TestStageLatencies();
+
+void TestRemoveDuplicates();
+
+void TestWordFrequencies();
+
+void TestWorkStealingPoolReuse();
+
 
 template<typename Collection>
 std::ostream& Print(std::ostream& out, Collection& container) {
@@ -106,6 +167,15 @@ AssertImpl(bool value, const std::string& expr_str, const std::string& file, con
 
 #define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
 
+// Выдачи совпадают по размеру, релевантности до бита и рейтингу, а при compare_ids — и по id.
+// Без id сравниваются выдачи, где документы с равными релевантностью и рейтингом идут в любом порядке
+void AssertSameDocuments(const std::vector<Document>& result, const std::vector<Document>& expected,
+                         const std::string& hint, bool compare_ids = true);
+
+// Каждый запрос находит на search_server то же, что на expected_server, обычно собранном заново
+void AssertSameTopDocuments(const SearchServer& search_server, const SearchServer& expected_server,
+                            const std::vector<std::string>& queries);
+
 template<typename T>
 void RunTestImpl(const T& func, const std::string& func_str) {
     func();
@@ -0,0 +1,63 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// Меньше этого числа документов делить работу между потоками невыгодно
+constexpr size_t PARALLEL_SELECTION_THRESHOLD = 10'000;
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        return lhs.rating > rhs.rating;
+    } else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+void SelectTopDocuments(const std::execution::sequenced_policy&, std::vector<Document>& documents, size_t top_count) {
+    if (documents.size() > top_count) {
+        std::partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), IsMoreRelevant);
+        documents.resize(top_count);
+        // Результаты запросов хранятся долго, поэтому память под отброшенных кандидатов возвращается
+        documents.shrink_to_fit();
+    } else {
+        std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+    }
+}
+
+void SelectTopDocuments(const std::execution::parallel_policy&, std::vector<Document>& documents, size_t top_count) {
+    const size_t chunk_count = std::max(1u, std::thread::hardware_concurrency());
+    if (chunk_count == 1 || documents.size() < std::max(PARALLEL_SELECTION_THRESHOLD, chunk_count * top_count)) {
+        SelectTopDocuments(std::execution::seq, documents, top_count);
+        return;
+    }
+
+    const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+    std::vector<size_t> chunk_begins;
+    for (size_t begin = 0; begin < documents.size(); begin += chunk_size) {
+        chunk_begins.push_back(begin);
+    }
+    std::for_each(std::execution::par, chunk_begins.begin(), chunk_begins.end(),
+                  [&documents, chunk_size, top_count](size_t begin) {
+                      const auto first = documents.begin() + begin;
+                      const auto last = documents.begin() + std::min(begin + chunk_size, documents.size());
+                      std::partial_sort(first, first + std::min<size_t>(top_count, last - first), last, IsMoreRelevant);
+                  });
+
+    // Лучшие документы каждого фрагмента сдвигаются в начало вектора и отбираются ещё раз.
+    // Кандидаты, которые уже стоят на месте, не перемещаются: std::move не допускает начала
+    // назначения внутри исходного диапазона
+    auto candidates_end = documents.begin();
+    for (size_t begin : chunk_begins) {
+        const auto first = documents.begin() + begin;
+        const size_t count = std::min(top_count, documents.size() - begin);
+        if (candidates_end == first) {
+            candidates_end += count;
+        } else {
+            candidates_end = std::move(first, first + count, candidates_end);
+        }
+    }
+    documents.erase(candidates_end, documents.end());
+    SelectTopDocuments(std::execution::seq, documents, top_count);
+}
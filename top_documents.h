@@ -0,0 +1,18 @@
+#pragma once
+
+#include <execution>
+#include <vector>
+
+#include "document.h"
+
+constexpr double EPSILON = 1e-6;
+
+// Документы упорядочиваются по убыванию релевантности, при равной релевантности — по убыванию рейтинга
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Оставляет в documents не больше top_count лучших документов, упорядоченных по IsMoreRelevant.
+// Полная сортировка не выполняется: выбор стоит O(N log K) вместо O(N log N)
+void SelectTopDocuments(const std::execution::sequenced_policy&, std::vector<Document>& documents, size_t top_count);
+
+// Параллельная версия: лучшие документы выбираются в каждом фрагменте независимо, а затем кандидаты сливаются
+void SelectTopDocuments(const std::execution::parallel_policy&, std::vector<Document>& documents, size_t top_count);
@@ -0,0 +1,114 @@
+#include "work_stealing_pool.h"
+
+#include <utility>
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) : queues_(thread_count) {
+    threads_.reserve(thread_count);
+    for (size_t worker_index = 0; worker_index < thread_count; ++worker_index) {
+        threads_.emplace_back([this, worker_index] { RunWorker(worker_index); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard guard(state_mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t WorkStealingPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+void WorkStealingPool::Run(size_t count, const std::function<void(size_t, size_t)>& function) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard run_guard(run_mutex_);
+    // Соседние диапазоны достаются одному потоку, а воры забирают их с другого конца очереди
+    const size_t task_size = std::max<size_t>(1, count / (queues_.size() * TASKS_PER_THREAD));
+    const size_t task_count = (count + task_size - 1) / task_size;
+    const size_t tasks_per_queue = (task_count + queues_.size() - 1) / queues_.size();
+    std::exception_ptr error;
+    {
+        // Задачи и счётчики публикуются вместе: поток, ещё не вышедший из прошлого запуска, может
+        // взять новую задачу сразу, но уменьшит счётчики только после того, как они выставлены
+        std::unique_lock lock(state_mutex_);
+        for (size_t task_index = 0; task_index < task_count; ++task_index) {
+            TaskQueue& queue = queues_[task_index / tasks_per_queue];
+            std::lock_guard guard(queue.mutex);
+            queue.tasks.push_front({task_index * task_size, std::min(count, (task_index + 1) * task_size),
+                                    &function});
+        }
+        queued_task_count_ = task_count;
+        remaining_index_count_ = count;
+        work_cv_.notify_all();
+        done_cv_.wait(lock, [this] { return remaining_index_count_ == 0; });
+        error = std::exchange(error_, nullptr);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool WorkStealingPool::PopTask(size_t worker_index, Task& task) {
+    {
+        TaskQueue& own_queue = queues_[worker_index];
+        std::lock_guard guard(own_queue.mutex);
+        if (!own_queue.tasks.empty()) {
+            task = own_queue.tasks.back();
+            own_queue.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        TaskQueue& victim_queue = queues_[(worker_index + offset) % queues_.size()];
+        std::lock_guard guard(victim_queue.mutex);
+        if (!victim_queue.tasks.empty()) {
+            task = victim_queue.tasks.front();
+            victim_queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::RunWorker(size_t worker_index) {
+    while (true) {
+        {
+            std::unique_lock lock(state_mutex_);
+            work_cv_.wait(lock, [this] { return stop_ || queued_task_count_ > 0; });
+            if (stop_) {
+                return;
+            }
+        }
+        Task task{};
+        while (PopTask(worker_index, task)) {
+            {
+                std::lock_guard guard(state_mutex_);
+                --queued_task_count_;
+            }
+            std::exception_ptr error;
+            for (size_t index = task.begin; index < task.end; ++index) {
+                try {
+                    (*task.function)(worker_index, index);
+                } catch (...) {
+                    error = std::current_exception();
+                    break;
+                }
+            }
+            std::lock_guard guard(state_mutex_);
+            if (error && !error_) {
+                error_ = error;
+            }
+            remaining_index_count_ -= task.end - task.begin;
+            if (remaining_index_count_ == 0) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с собственной очередью задач у каждого потока. Поток берёт задачи из конца своей
+// очереди, а когда она пуста, крадёт из начала чужих, поэтому задачи разной стоимости
+// распределяются между потоками без общей очереди
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool();
+
+    size_t GetThreadCount() const;
+
+    // Вызывает function(worker_index, index) для каждого index из [0, count) и ждёт завершения.
+    // worker_index меньше GetThreadCount(), одновременные вызовы получают разные worker_index,
+    // поэтому по нему можно держать рабочие буферы потока. Если function бросает исключение,
+    // оставшиеся индексы её задачи пропускаются, а исключение перебрасывается после остальных задач
+    template<typename Function>
+    void ForEachIndex(size_t count, Function function) {
+        Run(count, [&function](size_t worker_index, size_t index) {
+            function(worker_index, index);
+        });
+    }
+
+private:
+    // Несколько задач на поток, чтобы было что красть
+    static constexpr size_t TASKS_PER_THREAD = 8;
+
+    struct Task {
+        size_t begin;
+        size_t end;
+        const std::function<void(size_t, size_t)>* function;
+    };
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<TaskQueue> queues_;
+    std::vector<std::thread> threads_;
+
+    // Пул выполняет один ForEachIndex за раз
+    std::mutex run_mutex_;
+
+    std::mutex state_mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    size_t queued_task_count_ = 0;
+    size_t remaining_index_count_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+
+    void Run(size_t count, const std::function<void(size_t, size_t)>& function);
+
+    bool PopTask(size_t worker_index, Task& task);
+
+    void RunWorker(size_t worker_index);
+};